@@ -0,0 +1,291 @@
+/**
+ * @file analysis.cpp
+ * @author Maxi Barmetler (https://github.com/MixusMinimax)
+ * @brief Validates loaded Mazes and collects statistics.
+ * @version 0.1
+ * @date 2020-04-11
+ */
+
+#include <iostream>
+#include <thread>
+#include <algorithm>
+
+#include "analysis.hpp"
+
+#pragma region namespace maze
+namespace maze
+{
+/***************************************
+// Maze Report                        //
+***************************************/
+#pragma region Maze Report
+
+bool MazeReport::consistent() const
+{
+    return mismatch_ew == 0 && mismatch_ns == 0 && out_of_bounds == 0;
+}
+
+bool MazeReport::perfect() const
+{
+    return consistent() && components == 1 && cycles == 0;
+}
+
+void MazeReport::print(bool stats) const
+{
+    std::cout << "East/west mismatches: " << mismatch_ew << std::endl
+              << "North/south mismatches: " << mismatch_ns << std::endl
+              << "Passages out of bounds: " << out_of_bounds << std::endl
+              << "Components: " << components << std::endl
+              << "Loops: " << cycles << std::endl
+              << "Perfect: " << (perfect() ? "true" : "false") << std::endl;
+
+    if (!stats)
+        return;
+
+    std::cout << "Passages: " << edges << std::endl
+              << "Isolated cells: " << isolated << std::endl
+              << "Dead ends: " << dead_ends << std::endl
+              << "Corridor cells: " << corridors << std::endl
+              << "3-way junctions: " << junctions3 << std::endl
+              << "4-way junctions: " << junctions4 << std::endl
+              << "Corridor lengths:" << std::endl;
+    for (size_t i = 0; i < corridor_lengths.size(); ++i)
+        if (corridor_lengths[i])
+            std::cout << "  " << i << ": " << corridor_lengths[i] << std::endl;
+}
+
+#pragma endregion // Maze Report end
+
+/***************************************
+// Maze Analyzer                      //
+***************************************/
+#pragma region Maze Analyzer
+
+#define NORTH 0b1000
+#define EAST 0b0100
+#define SOUTH 0b0010
+#define WEST 0b0001
+
+MazeAnalyzer::MazeAnalyzer(Maze *_maze, uint _threads)
+{
+    maze = _maze;
+    threads = _threads ? _threads : std::max(1u, std::thread::hardware_concurrency());
+}
+
+uint MazeAnalyzer::find(uint i)
+{
+    while (parent[i] != i)
+    {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+bool MazeAnalyzer::unite(uint a, uint b)
+{
+    a = find(a);
+    b = find(b);
+    if (a == b)
+        return false;
+    // Always link to the smaller index, so that bands never write outside of their own rows
+    if (a < b)
+        parent[b] = a;
+    else
+        parent[a] = b;
+    return true;
+}
+
+void MazeAnalyzer::check_band(uint y0, uint y1, MazeReport *report)
+{
+    uint w = maze->w;
+    uint h = maze->h;
+    const uint8_t *field = (const uint8_t *)maze->field;
+    std::vector<uint8_t> zeros(w, 0);
+
+    ulong mismatch_ew = 0, mismatch_ns = 0, out_of_bounds = 0;
+
+    // All loops below are branch free so that the compiler can vectorize them
+    for (uint y = y0; y < y1; ++y)
+    {
+        const uint8_t *a = field + (ulong)y * w;
+        const uint8_t *up = y > 0 ? a - w : zeros.data();
+        const uint8_t *down = y < h - 1 ? a + w : zeros.data();
+        uint8_t *m = mask.data() + (ulong)y * w;
+
+        for (uint x = 0; x < w; ++x)
+            m[x] = a[x] & (((up[x] << 2) & NORTH) | ((down[x] >> 2) & SOUTH));
+        for (uint x = 0; x + 1 < w; ++x)
+            m[x] |= a[x] & (a[x + 1] << 2) & EAST;
+        for (uint x = 1; x < w; ++x)
+            m[x] |= a[x] & (a[x - 1] >> 2) & WEST;
+
+        for (uint x = 0; x + 1 < w; ++x)
+            mismatch_ew += ((a[x] >> 2) ^ a[x + 1]) & 1;
+        if (y < h - 1)
+            for (uint x = 0; x < w; ++x)
+                mismatch_ns += (((a[x] << 2) ^ down[x]) & NORTH) >> 3;
+
+        if (y == 0)
+            for (uint x = 0; x < w; ++x)
+                out_of_bounds += (a[x] & NORTH) >> 3;
+        if (y == h - 1)
+            for (uint x = 0; x < w; ++x)
+                out_of_bounds += (a[x] & SOUTH) >> 1;
+        out_of_bounds += (a[0] & WEST) + ((a[w - 1] & EAST) >> 2);
+    }
+
+    report->mismatch_ew = mismatch_ew;
+    report->mismatch_ns = mismatch_ns;
+    report->out_of_bounds = out_of_bounds;
+}
+
+void MazeAnalyzer::scan_band(uint y0, uint y1, MazeReport *report)
+{
+    uint w = maze->w;
+    const uint8_t *m = mask.data();
+
+    auto degree = [m](uint i) { return __builtin_popcount(m[i]); };
+    // Neighbors of i through its (at most two) passages
+    auto neighbors = [m, w](uint i, uint *n) {
+        uint k = 0;
+        if (m[i] & NORTH)
+            n[k++] = i - w;
+        if (m[i] & EAST)
+            n[k++] = i + 1;
+        if (m[i] & SOUTH)
+            n[k++] = i + w;
+        if (m[i] & WEST)
+            n[k++] = i - 1;
+    };
+
+    ulong counts[5] = {0};
+    std::vector<ulong> lengths;
+
+    for (uint y = y0; y < y1; ++y)
+    {
+        for (uint x = 0; x < w; ++x)
+        {
+            uint i = y * w + x;
+            int d = degree(i);
+            ++counts[d];
+
+            if ((m[i] & EAST) && !unite(i, i + 1))
+                ++report->cycles;
+            if ((m[i] & SOUTH) && y + 1 < y1 && !unite(i, i + w))
+                ++report->cycles;
+            report->edges += ((m[i] & EAST) >> 2) + ((m[i] & SOUTH) && y + 1 < y1);
+
+            if (d != 2)
+                continue;
+
+            // Corridors are walked from both of their ends, only the end with the lower index counts
+            uint n[2];
+            neighbors(i, n);
+            if (degree(n[0]) == 2 && degree(n[1]) == 2)
+                continue;
+
+            uint prev = i;
+            uint cur = degree(n[0]) == 2 ? n[0] : n[1];
+            uint length = 1;
+            while (degree(cur) == 2)
+            {
+                ++length;
+                uint next[2];
+                neighbors(cur, next);
+                uint tmp = next[0] == prev ? next[1] : next[0];
+                prev = cur;
+                cur = tmp;
+            }
+            if (i <= prev)
+            {
+                if (lengths.size() <= length)
+                    lengths.resize(length + 1, 0);
+                ++lengths[length];
+            }
+        }
+    }
+
+    report->isolated = counts[0];
+    report->dead_ends = counts[1];
+    report->corridors = counts[2];
+    report->junctions3 = counts[3];
+    report->junctions4 = counts[4];
+    report->corridor_lengths = std::move(lengths);
+}
+
+MazeReport MazeAnalyzer::run()
+{
+    uint w = maze->w;
+    uint h = maze->h;
+    ulong l = (ulong)w * h;
+
+    mask.assign(l, 0);
+    parent.resize(l);
+    for (ulong i = 0; i < l; ++i)
+        parent[i] = i;
+
+    uint bands = std::clamp(threads, 1u, std::max(1u, h));
+    std::vector<uint> bounds(bands + 1);
+    for (uint b = 0; b <= bands; ++b)
+        bounds[b] = (ulong)h * b / bands;
+    std::vector<MazeReport> reports(bands);
+
+    // Both passes need all rows of the previous one, so threads are joined in between
+    for (auto pass : {&MazeAnalyzer::check_band, &MazeAnalyzer::scan_band})
+    {
+        std::vector<std::thread> workers;
+        for (uint b = 1; b < bands; ++b)
+            workers.emplace_back(pass, this, bounds[b], bounds[b + 1], &reports[b]);
+        (this->*pass)(bounds[0], bounds[1], &reports[0]);
+        for (auto &t : workers)
+            t.join();
+    }
+
+    MazeReport report;
+    for (auto &r : reports)
+    {
+        report.mismatch_ew += r.mismatch_ew;
+        report.mismatch_ns += r.mismatch_ns;
+        report.out_of_bounds += r.out_of_bounds;
+        report.edges += r.edges;
+        report.cycles += r.cycles;
+        report.isolated += r.isolated;
+        report.dead_ends += r.dead_ends;
+        report.corridors += r.corridors;
+        report.junctions3 += r.junctions3;
+        report.junctions4 += r.junctions4;
+        if (report.corridor_lengths.size() < r.corridor_lengths.size())
+            report.corridor_lengths.resize(r.corridor_lengths.size(), 0);
+        for (size_t i = 0; i < r.corridor_lengths.size(); ++i)
+            report.corridor_lengths[i] += r.corridor_lengths[i];
+    }
+
+    // Stitch bands together along their southern edge
+    for (uint b = 1; b < bands; ++b)
+    {
+        ulong row = (ulong)(bounds[b] - 1) * w;
+        for (uint x = 0; x < w; ++x)
+        {
+            if (mask[row + x] & SOUTH)
+            {
+                ++report.edges;
+                if (!unite(row + x, row + x + w))
+                    ++report.cycles;
+            }
+        }
+    }
+
+    report.components = l - (report.edges - report.cycles);
+    return report;
+}
+
+#undef NORTH
+#undef EAST
+#undef SOUTH
+#undef WEST
+
+#pragma endregion // Maze Analyzer end
+
+} /* namespace maze */
+#pragma endregion
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vector>
+
+#include "maze.hpp"
+
+#pragma region namespace maze
+namespace maze
+{
+/**
+ * @brief Result of MazeAnalyzer::run()
+ */
+struct MazeReport
+{
+    // Consistency
+    ulong mismatch_ew = 0;  /// Passages that are set on only one side of an east/west wall
+    ulong mismatch_ns = 0;  /// Passages that are set on only one side of a north/south wall
+    ulong out_of_bounds = 0; /// Passages that lead out of the maze
+
+    // Connectivity (only passages set on both sides are counted)
+    ulong edges = 0;      /// Number of passages
+    ulong cycles = 0;     /// Passages that close a loop
+    ulong components = 0; /// Number of connected components
+
+    // Statistics
+    ulong isolated = 0;   /// Cells without any passage
+    ulong dead_ends = 0;  /// Cells with exactly one passage
+    ulong corridors = 0;  /// Cells with exactly two passages
+    ulong junctions3 = 0; /// Cells with exactly three passages
+    ulong junctions4 = 0; /// Cells with four passages
+    std::vector<ulong> corridor_lengths; /// Histogram: index is the number of cells in a corridor
+
+    /**
+     * @return true if all passages are set on both sides and none leave the maze
+     */
+    bool consistent() const;
+
+    /**
+     * @return true if the maze is a spanning tree, i.e. consistent, connected and free of loops
+     */
+    bool perfect() const;
+
+    /**
+     * @brief Prints the report into the console
+     *
+     * @param    stats               Also print statistics, not only validation results
+     */
+    void print(bool stats) const;
+};
+
+class MazeAnalyzer
+{
+private:
+    Maze *maze;                /// Pointer to maze::Maze object that should be analyzed
+    uint threads;              /// Number of row bands that are processed in parallel
+    std::vector<uint8_t> mask; /// Passages of each Node that are confirmed by its neighbor
+    std::vector<uint> parent;  /// Union-find forest over all Nodes
+
+    /**
+     * @brief Union-find lookup with path halving
+     */
+    uint find(uint i);
+
+    /**
+     * @brief Union-find merge
+     *
+     * @return false if a and b were already connected
+     */
+    bool unite(uint a, uint b);
+
+    /**
+     * @brief Check walls of rows [y0, y1) against their neighbors and fill mask
+     */
+    void check_band(uint y0, uint y1, MazeReport *report);
+
+    /**
+     * @brief Connect and count all Nodes of rows [y0, y1), ignoring passages south of y1 - 1
+     */
+    void scan_band(uint y0, uint y1, MazeReport *report);
+
+public:
+    /**
+     * @brief Construct a new Maze Analyzer object
+     *
+     * @param    _maze               Pointer to maze::Maze object, field has to be loaded
+     * @param    _threads            Number of worker threads, 0 for hardware concurrency
+     */
+    MazeAnalyzer(Maze *_maze, uint _threads = 0);
+
+    /**
+     * @brief Validate and analyze the maze
+     *
+     * @return MazeReport           Consistency, connectivity and statistics
+     */
+    MazeReport run();
+};
+} // namespace maze
+#pragma endregion
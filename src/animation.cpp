@@ -0,0 +1,396 @@
+/**
+ * @file animation.cpp
+ * @author Maxi Barmetler (https://github.com/MixusMinimax)
+ * @brief Writes the generation of a maze as GIF or raw frames, without a window.
+ * @version 0.1
+ * @date 2020-04-11
+ */
+
+#include <algorithm>
+#include <string.h>
+
+#include "animation.hpp"
+
+// Palette indices, the colors are the same as in the window
+static constexpr uint8_t COLOR_UNVISITED = 0;
+static constexpr uint8_t COLOR_VISITED = 1;
+static constexpr uint8_t COLOR_WALL = 2;
+static constexpr uint8_t COLOR_TRANSPARENT = 3;
+
+static const uint8_t palette[4][3] = {{100, 20, 100}, {230, 230, 230}, {50, 50, 50}, {0, 0, 0}};
+
+#pragma region namespace maze
+namespace maze
+{
+/**
+ * @brief Index of the first changed cell in a row, w if there is none
+ */
+static uint first_changed(const bool *row, uint w)
+{
+    uint x = 0;
+    // Most rows did not change at all, skip them eight cells at a time
+    for (; x + 8 <= w; x += 8)
+    {
+        uint64_t word;
+        memcpy(&word, row + x, 8);
+        if (word)
+            break;
+    }
+    while (x < w && !row[x])
+        ++x;
+    return x;
+}
+
+/**
+ * @brief Index one past the last changed cell in a row, at least start
+ */
+static uint last_changed(const bool *row, uint w, uint start)
+{
+    while (w > start && !row[w - 1])
+        --w;
+    return w;
+}
+
+static void put16(std::ofstream &ofs, uint16_t value)
+{
+    uint8_t bytes[2] = {(uint8_t)value, (uint8_t)(value >> 8)};
+    ofs.write((char *)bytes, 2);
+}
+
+static void put32(std::ofstream &ofs, uint value)
+{
+    ofs.write((char *)&value, 4);
+}
+
+Animation::Animation(Maze *_maze, std::string path, uint _cell_size, uint _queue_size)
+    : ofs(path, std::ios::binary | std::ios::trunc)
+{
+    maze = _maze;
+    cell_size = std::max(1u, _cell_size);
+    queue_size = std::max(1u, _queue_size);
+    gif = path.size() >= 4 && !strcasecmp(path.c_str() + path.size() - 4, ".gif");
+
+    if (!ofs)
+        return;
+
+    uint width = maze->w * cell_size;
+    uint height = maze->h * cell_size;
+    if (gif)
+    {
+        ofs.write("GIF89a", 6);
+        put16(ofs, width);
+        put16(ofs, height);
+        // Global color table with 4 entries, 8 bits per channel
+        const uint8_t flags[3] = {0xf1, 0, 0};
+        ofs.write((char *)flags, 3);
+        ofs.write((char *)palette, sizeof(palette));
+        // Loop forever
+        const uint8_t loop[19] = {0x21, 0xff, 11, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 3, 1, 0, 0, 0};
+        ofs.write((char *)loop, sizeof(loop));
+    }
+    else
+    {
+        ofs.write("MZAN", 4);
+        put32(ofs, width);
+        put32(ofs, height);
+        ofs.write((char *)palette, sizeof(palette));
+    }
+
+    worker = std::thread(&Animation::run, this);
+}
+
+Animation::~Animation()
+{
+    close();
+}
+
+bool Animation::is_open() const
+{
+    return ofs.is_open();
+}
+
+void Animation::capture(uint delay)
+{
+    uint w = maze->w;
+    uint h = maze->h;
+
+    Frame frame;
+    frame.delay = delay;
+
+    // Changed columns [begin, end) of every row
+    std::vector<std::pair<uint, uint>> spans(h);
+    for (uint y = 0; y < h; ++y)
+    {
+        const bool *row = maze->changed + (size_t)y * w;
+        uint begin = first_changed(row, w);
+        spans[y] = {begin, last_changed(row, w, begin)};
+    }
+
+    // Consecutive rows with changes become one rectangle
+    for (uint y = 0; y < h;)
+    {
+        if (spans[y].first == spans[y].second)
+        {
+            ++y;
+            continue;
+        }
+
+        Rect rect = {spans[y].first, y, 0, 0};
+        uint right = spans[y].second;
+        for (; y < h && spans[y].first != spans[y].second; ++y)
+        {
+            rect.x = std::min(rect.x, spans[y].first);
+            right = std::max(right, spans[y].second);
+            ++rect.h;
+        }
+        rect.w = right - rect.x;
+
+        for (uint ry = rect.y; ry < rect.y + rect.h; ++ry)
+        {
+            size_t i = (size_t)ry * w + rect.x;
+            for (uint rx = 0; rx < rect.w; ++rx, ++i)
+            {
+                frame.cells.push_back(maze->changed[i] ? maze->field[i].bin() : UNCHANGED);
+                maze->changed[i] = false;
+            }
+        }
+        frame.rects.push_back(rect);
+    }
+
+    ++frames;
+    if (!worker.joinable())
+        return;
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        space.wait(lock, [this] { return queue.size() < queue_size; });
+        queue.push_back(std::move(frame));
+    }
+    ready.notify_one();
+}
+
+void Animation::render(const Rect &rect, const uint8_t *&cells, uint x, uint y, uint stride)
+{
+    uint s = cell_size;
+    uint wall_thickness = std::max(1u, s / 16);
+    uint wall_length = s > 2 * wall_thickness ? s - 2 * wall_thickness : 1;
+    uint wall_offset = s - wall_thickness;
+
+    auto fill = [&](uint px, uint py, uint pw, uint ph, uint8_t color) {
+        for (uint j = 0; j < ph; ++j)
+            memset(&pixels[(size_t)(py + j) * stride + px], color, pw);
+    };
+
+    // Same shapes as the window draws
+    for (uint cy = 0; cy < rect.h; ++cy)
+    {
+        for (uint cx = 0; cx < rect.w; ++cx)
+        {
+            uint8_t bin = *cells++;
+            if (bin == UNCHANGED)
+                continue;
+
+            Node node(bin);
+            uint rx = x + cx * s;
+            uint ry = y + cy * s;
+
+            fill(rx, ry, s, s, bin ? COLOR_VISITED : COLOR_UNVISITED);
+
+            if (s > 1)
+            {
+                fill(rx, ry, wall_thickness, wall_thickness, COLOR_WALL);
+                if (s > 2)
+                {
+                    fill(rx, ry + wall_offset, wall_thickness, wall_thickness, COLOR_WALL);
+                    fill(rx + wall_offset, ry, wall_thickness, wall_thickness, COLOR_WALL);
+                    fill(rx + wall_offset, ry + wall_offset, wall_thickness, wall_thickness, COLOR_WALL);
+                }
+            }
+
+            if (!node.north() && s > 1)
+                fill(rx + wall_thickness, ry, wall_length, wall_thickness, COLOR_WALL);
+            if (!node.east() && s > 2)
+                fill(rx + wall_offset, ry + wall_thickness, wall_thickness, wall_length, COLOR_WALL);
+            if (!node.south() && s > 2)
+                fill(rx + wall_thickness, ry + wall_offset, wall_length, wall_thickness, COLOR_WALL);
+            if (!node.west() && s > 1)
+                fill(rx, ry + wall_thickness, wall_thickness, wall_length, COLOR_WALL);
+        }
+    }
+}
+
+void Animation::compress(size_t count)
+{
+    // 4 colors: codes 0-3 are pixels, 4 clears the table, 5 ends the image
+    const uint min_size = 2;
+    const uint clear = 1 << min_size;
+    const uint end = clear + 1;
+
+    // Code of every string extended by one pixel, 0 if not in the table yet
+    std::vector<uint16_t> table(4096 << min_size, 0);
+    uint size = min_size + 1;
+    uint max = end;
+
+    encoded.clear();
+    encoded.push_back(min_size);
+    size_t block = encoded.size();
+    encoded.push_back(0);
+
+    uint32_t bits = 0;
+    uint used = 0;
+    auto put = [&](uint code) {
+        bits |= code << used;
+        used += size;
+        while (used >= 8)
+        {
+            // Data is split into blocks of at most 255 bytes, each prefixed by its length
+            if (encoded[block] == 255)
+            {
+                block = encoded.size();
+                encoded.push_back(0);
+            }
+            encoded.push_back(bits & 0xff);
+            ++encoded[block];
+            bits >>= 8;
+            used -= 8;
+        }
+    };
+
+    put(clear);
+    uint prefix = pixels[0];
+    for (size_t i = 1; i < count; ++i)
+    {
+        uint16_t &next = table[(prefix << min_size) | pixels[i]];
+        if (next)
+        {
+            prefix = next;
+            continue;
+        }
+
+        put(prefix);
+        next = ++max;
+        if (max >= 1u << size)
+            ++size;
+        if (max == 4095)
+        {
+            put(clear);
+            std::fill(table.begin(), table.end(), 0);
+            size = min_size + 1;
+            max = end;
+        }
+        prefix = pixels[i];
+    }
+    put(prefix);
+    // The decoder adds one more code after reading the last one, which might make the codes wider
+    if (max + 1 == 1u << size && size < 12)
+        ++size;
+    put(end);
+    // Pad the last byte
+    if (used)
+    {
+        size = 8 - used;
+        put(0);
+    }
+
+    if (encoded[block])
+        encoded.push_back(0);
+}
+
+void Animation::write(const Frame &frame)
+{
+    uint s = cell_size;
+    const uint8_t *cells = frame.cells.data();
+
+    if (!gif)
+    {
+        put32(ofs, frame.delay);
+        put32(ofs, frame.rects.size());
+        for (const Rect &rect : frame.rects)
+        {
+            uint stride = rect.w * s;
+            pixels.assign((size_t)stride * rect.h * s, COLOR_TRANSPARENT);
+            render(rect, cells, 0, 0, stride);
+
+            put32(ofs, rect.x * s);
+            put32(ofs, rect.y * s);
+            put32(ofs, stride);
+            put32(ofs, rect.h * s);
+            ofs.write((char *)pixels.data(), pixels.size());
+        }
+        return;
+    }
+
+    // A GIF frame is a single image, so all rectangles are drawn into their bounding box,
+    // the space between them stays transparent and costs next to nothing after compression
+    uint left = maze->w, top = maze->h, right = 0, bottom = 0;
+    for (const Rect &rect : frame.rects)
+    {
+        left = std::min(left, rect.x);
+        top = std::min(top, rect.y);
+        right = std::max(right, rect.x + rect.w);
+        bottom = std::max(bottom, rect.y + rect.h);
+    }
+    if (frame.rects.empty())
+        left = top = 0, right = bottom = 1;
+
+    uint stride = (right - left) * s;
+    pixels.assign((size_t)stride * (bottom - top) * s, COLOR_TRANSPARENT);
+    for (const Rect &rect : frame.rects)
+        render(rect, cells, (rect.x - left) * s, (rect.y - top) * s, stride);
+    compress(pixels.size());
+
+    // Graphic control extension: keep the previous frame, index 3 is transparent
+    const uint8_t control[4] = {0x21, 0xf9, 4, (1 << 2) | 1};
+    ofs.write((char *)control, 4);
+    put16(ofs, frame.delay);
+    const uint8_t transparent[2] = {COLOR_TRANSPARENT, 0};
+    ofs.write((char *)transparent, 2);
+
+    // Image descriptor without local color table
+    ofs.put(0x2c);
+    put16(ofs, left * s);
+    put16(ofs, top * s);
+    put16(ofs, stride);
+    put16(ofs, (bottom - top) * s);
+    ofs.put(0);
+    ofs.write((char *)encoded.data(), encoded.size());
+}
+
+void Animation::run()
+{
+    while (1)
+    {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [this] { return !queue.empty() || done; });
+            if (queue.empty())
+                return;
+            frame = std::move(queue.front());
+            queue.pop_front();
+        }
+        space.notify_one();
+        write(frame);
+    }
+}
+
+bool Animation::close()
+{
+    if (!worker.joinable())
+        return false;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+    }
+    ready.notify_one();
+    worker.join();
+
+    if (gif)
+        ofs.put(0x3b);
+    bytes = ofs.tellp();
+    ofs.close();
+    return !ofs.fail();
+}
+} // namespace maze
+#pragma endregion
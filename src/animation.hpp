@@ -0,0 +1,128 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "maze.hpp"
+
+#pragma region namespace maze
+namespace maze
+{
+/**
+ * @brief Writes the generation of a Maze as an animation, without a window.
+ *
+ * Every captured frame only contains the cells marked in Maze::changed since the previous frame,
+ * grouped into rectangles of consecutive rows. Cells inside a rectangle that did not change are
+ * transparent. Rendering and encoding happen on a worker thread, capture() only copies the
+ * changed cells and returns.
+ *
+ * Paths ending in .gif are written as animated GIF, everything else as raw frames:
+ * "MZAN", width, height (pixels, 4 bytes each), 4 RGB palette entries, then for every frame the
+ * delay and the number of rectangles (4 bytes each) and for every rectangle x, y, w, h (pixels,
+ * 4 bytes each) followed by w * h palette indices. Index 3 is transparent.
+ */
+class Animation
+{
+public:
+    struct Rect
+    {
+        uint x; /// Left column of the rectangle
+        uint y; /// Top row of the rectangle
+        uint w; /// Width in cells
+        uint h; /// Height in cells
+    };
+
+    struct Frame
+    {
+        std::vector<Rect> rects;    /// Changed areas
+        std::vector<uint8_t> cells; /// Connection bitfields of all rectangles, row by row, UNCHANGED for cells that did not change
+        uint delay;                 /// Time to show the frame in 1/100 s
+    };
+
+    static constexpr uint8_t UNCHANGED = 0xff;
+
+private:
+    Maze *maze;                     /// Pointer to maze::Maze object that is animated
+    std::ofstream ofs;              /// Output file
+    bool gif;                       /// Write GIF instead of raw frames
+    uint cell_size;                 /// Edge length of a cell in pixels
+    uint queue_size;                /// Maximum number of frames waiting for the worker
+    std::deque<Frame> queue;        /// Captured frames that have not been written yet
+    std::mutex mutex;               /// Protects queue and done
+    std::condition_variable ready;  /// Signals the worker that a frame was queued or capturing is done
+    std::condition_variable space;  /// Signals capture() that the worker took a frame
+    bool done = false;              /// No more frames will be captured
+    std::thread worker;             /// Renders and encodes queued frames
+    std::vector<uint8_t> pixels;    /// Palette indices of the frame that is rendered, used by the worker
+    std::vector<uint8_t> encoded;   /// Encoded frame, used by the worker
+
+public:
+    ulong frames = 0;               /// Number of captured frames
+    ulong bytes = 0;                /// Bytes written, valid after close()
+
+private:
+    /**
+     * @brief Render the changed cells of a rectangle into pixels
+     *
+     * @param    rect                Rectangle to render
+     * @param    cells               Connection bitfields of the rectangle, advanced past it
+     * @param    x                   Left edge of the rectangle in pixels
+     * @param    y                   Top edge of the rectangle in pixels
+     * @param    stride              Width of pixels
+     */
+    void render(const Rect &rect, const uint8_t *&cells, uint x, uint y, uint stride);
+
+    /**
+     * @brief Encode pixels as GIF image data (LZW, split into sub-blocks) into encoded
+     */
+    void compress(size_t count);
+
+    /**
+     * @brief Write a frame to the file
+     */
+    void write(const Frame &frame);
+
+    /**
+     * @brief Worker thread, writes queued frames until close() is called
+     */
+    void run();
+
+public:
+    /**
+     * @brief Construct a new Animation object, create the file and start the worker
+     *
+     * @param    _maze               Pointer to maze::Maze object, field has to be loaded
+     * @param    path                Path to the file to write to
+     * @param    _cell_size          Edge length of a cell in pixels
+     * @param    _queue_size         Maximum number of frames waiting for the worker, capture() blocks if exceeded
+     */
+    Animation(Maze *_maze, std::string path, uint _cell_size, uint _queue_size = 64);
+
+    ~Animation();
+
+    /**
+     * @return true if the file could be created
+     */
+    bool is_open() const;
+
+    /**
+     * @brief Queue a frame of all cells changed since the previous frame and reset Maze::changed
+     *
+     * @param    delay               Time to show the frame in 1/100 s
+     */
+    void capture(uint delay = 2);
+
+    /**
+     * @brief Write all queued frames, stop the worker and finish the file
+     *
+     * @return true if everything was written
+     */
+    bool close();
+};
+} // namespace maze
+#pragma endregion
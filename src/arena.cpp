@@ -0,0 +1,162 @@
+/**
+ * @file arena.cpp
+ * @author Maxi Barmetler (https://github.com/MixusMinimax)
+ * @brief Allocates memory for Mazes.
+ * @version 0.1
+ * @date 2020-04-11
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <new>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+#include "arena.hpp"
+
+#define HUGE_PAGE_SIZE (2ul << 20)
+#define MIN_CHUNK_SIZE (2ul << 20)
+
+#pragma region namespace maze
+namespace maze
+{
+static size_t round_up(size_t size, size_t to)
+{
+    return (size + to - 1) / to * to;
+}
+
+Arena::Arena(Pages _pages)
+{
+    pages = _pages;
+}
+
+Arena::~Arena()
+{
+    release();
+}
+
+Arena::Chunk Arena::map(size_t size)
+{
+    timespec t;
+    rusage usage;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    getrusage(RUSAGE_SELF, &usage);
+    ulong start_us = t.tv_sec * 1000000 + t.tv_nsec / 1000;
+    ulong start_faults = usage.ru_minflt + usage.ru_majflt;
+
+    size = round_up(std::max(size, MIN_CHUNK_SIZE), HUGE_PAGE_SIZE);
+
+    Chunk chunk = {NULL, size};
+    if (pages == EXPLICIT)
+    {
+        void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED)
+            chunk.base = (uint8_t *)p;
+        else
+        {
+            std::cerr << "No explicit huge pages available, using transparent huge pages" << std::endl;
+            pages = TRANSPARENT;
+        }
+    }
+
+    if (!chunk.base)
+    {
+        // Over-allocate by one huge page, so that the chunk can start on a huge page boundary
+        size_t mapped = size + (pages == TRANSPARENT ? HUGE_PAGE_SIZE : 0);
+        void *p = mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+            throw std::bad_alloc();
+
+        uint8_t *base = (uint8_t *)p;
+        if (pages == TRANSPARENT)
+        {
+            uint8_t *aligned = (uint8_t *)round_up((size_t)base, HUGE_PAGE_SIZE);
+            if (aligned > base)
+                munmap(base, aligned - base);
+            if (base + mapped > aligned + size)
+                munmap(aligned + size, base + mapped - (aligned + size));
+            base = aligned;
+            madvise(base, size, MADV_HUGEPAGE);
+        }
+        chunk.base = base;
+    }
+
+    // Fault in every page now, instead of scattered over the first pass through the maze
+    long page = sysconf(_SC_PAGESIZE);
+    for (size_t i = 0; i < size; i += page)
+        chunk.base[i] = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    getrusage(RUSAGE_SELF, &usage);
+    fault_us += t.tv_sec * 1000000 + t.tv_nsec / 1000 - start_us;
+    faults += usage.ru_minflt + usage.ru_majflt - start_faults;
+
+    return chunk;
+}
+
+void Arena::release()
+{
+    for (auto &c : chunks)
+        munmap(c.base, c.size);
+    chunks.clear();
+    used = 0;
+}
+
+void Arena::reserve(size_t size)
+{
+    if (!chunks.empty() && chunks.back().size - used >= size)
+        return;
+    chunks.push_back(map(size));
+    used = 0;
+}
+
+void *Arena::allocate(size_t size)
+{
+    size = round_up(std::max(size, (size_t)1), alignment);
+    reserve(size);
+
+    void *p = chunks.back().base + used;
+    used += size;
+    total += size;
+    return p;
+}
+
+void Arena::reset()
+{
+    if (chunks.size() > 1)
+    {
+        // Keep the largest chunk if everything fits into it, it is already faulted in
+        auto largest = std::max_element(chunks.begin(), chunks.end(),
+                                        [](const Chunk &a, const Chunk &b) { return a.size < b.size; });
+        Chunk keep = *largest;
+        if (keep.size >= total)
+            chunks.erase(largest);
+        release();
+        chunks.push_back(keep.size >= total ? keep : map(total));
+    }
+    used = 0;
+    total = 0;
+}
+
+size_t Arena::capacity() const
+{
+    size_t size = 0;
+    for (auto &c : chunks)
+        size += c.size;
+    return size;
+}
+
+ulong Arena::fault_time_us() const
+{
+    return fault_us;
+}
+
+ulong Arena::fault_count() const
+{
+    return faults;
+}
+
+} /* namespace maze */
+#pragma endregion
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <vector>
+
+#pragma region namespace maze
+namespace maze
+{
+/**
+ * @brief Bump allocator for maze sized buffers.
+ *
+ * Memory is mapped directly from the kernel, optionally backed by huge pages, and faulted in
+ * right away so that the cost is paid (and measured) in one place. reset() keeps the mapping,
+ * so successive mazes of similar size reuse memory that is already faulted in.
+ */
+class Arena
+{
+public:
+    enum Pages
+    {
+        NORMAL,      /// Regular 4 KiB pages
+        TRANSPARENT, /// Ask the kernel for transparent huge pages (madvise)
+        EXPLICIT     /// Huge pages from the hugetlbfs pool, falls back to TRANSPARENT if none are free
+    };
+
+    static const size_t alignment = 64; /// Alignment of every allocation, one cache line
+
+private:
+    struct Chunk
+    {
+        uint8_t *base; /// Start of the mapping
+        size_t size;   /// Size of the mapping
+    };
+
+    Pages pages;               /// Page size requested for new chunks
+    std::vector<Chunk> chunks; /// All mappings, allocations are served from the last one
+    size_t used = 0;           /// Bytes used in the last chunk
+    size_t total = 0;          /// Bytes allocated since the last reset()
+    ulong fault_us = 0;        /// Time spent mapping and faulting in memory
+    ulong faults = 0;          /// Page faults caused by faulting in memory
+
+    /**
+     * @brief Map, align and fault in a new chunk of at least size bytes
+     */
+    Chunk map(size_t size);
+
+    /**
+     * @brief Unmap all chunks
+     */
+    void release();
+
+public:
+    /**
+     * @brief Construct a new Arena object, no memory is mapped until the first allocation
+     *
+     * @param    _pages              Page size for all mappings
+     */
+    Arena(Pages _pages = NORMAL);
+
+    ~Arena();
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    /**
+     * @brief Make sure that the next size bytes can be allocated without mapping memory
+     */
+    void reserve(size_t size);
+
+    /**
+     * @brief Allocate size bytes, aligned to alignment. Memory is not initialized.
+     *
+     * @return void*                 Valid until the next reset() or destruction of the arena
+     */
+    void *allocate(size_t size);
+
+    /**
+     * @brief Free all allocations at once. If they did not fit into a single chunk, only the
+     *        largest chunk is kept, or replaced by a single one that is large enough if it is too small.
+     */
+    void reset();
+
+    /**
+     * @return size_t                Bytes mapped in total
+     */
+    size_t capacity() const;
+
+    /**
+     * @return ulong                 Time in microseconds spent mapping and faulting in memory
+     */
+    ulong fault_time_us() const;
+
+    /**
+     * @return ulong                 Number of page faults taken while faulting in memory
+     */
+    ulong fault_count() const;
+};
+} // namespace maze
+#pragma endregion
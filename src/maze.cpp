@@ -17,16 +17,32 @@
 #include <filesystem>
 #include <iosfwd>
 #include <tuple>
-#include <unordered_set>
+#include <type_traits>
 #include <SFML/Graphics.hpp>
 
 #include "maze.hpp"
+#include "analysis.hpp"
+#include "recording.hpp"
+#include "text.hpp"
+#include "query.hpp"
+#include "transform.hpp"
+#include "animation.hpp"
 
 #define DEBUG(x) //std::cout << x << std::endl;
 
 #define MAX_WIDTH 1800
 #define MAX_HEIGHT 950
 
+#define OPT_RECORD 256
+#define OPT_REPLAY 257
+#define OPT_SEEK 258
+#define OPT_TEXT 259
+#define OPT_QUERY 260
+#define OPT_HUGEPAGES 261
+#define OPT_TOPOLOGY 262
+#define OPT_ANIMATE 263
+#define OPT_EVERY 264
+
 static const std::string title = "SFMaze";
 static int verbose_flag = 0;
 static int bLegacy = 0;
@@ -35,6 +51,20 @@ static std::string output_path = "";
 static bool bDisplay = false;
 static bool bGenerate = false;
 static uint stepsPerFrame = 1;
+static int bValidate = 0;
+static int bAnalyze = 0;
+static std::string record_path = "";
+static std::string replay_path = "";
+static ulong seekStep = -1ul;
+static int bReverse = 0;
+static std::string text_path = "";
+static int bUnicode = 0;
+static std::string query_path = "";
+static int bQueryPaths = 0;
+static maze::Arena::Pages pages = maze::Arena::NORMAL;
+static std::string topology = maze::Square::name;
+static std::string animate_path = "";
+static ulong animateEvery = 1;
 
 #pragma region namespace maze
 namespace maze
@@ -44,53 +74,8 @@ namespace maze
 ***************************************/
 #pragma region Node
 
-Node::Node(uint8_t bin)
-{
-    _bin = bin;
-}
-
-#define temp(name, index)                              \
-    bool Node::name(uint8_t val = 2)                   \
-    {                                                  \
-        if (val == 2)                                  \
-            return ((_bin >> (3 - (index))) & 1) == 1; \
-        if (val == 0)                                  \
-        {                                              \
-            _bin &= ~(1 << (3 - (index)));             \
-            return false;                              \
-        }                                              \
-        if (val == 1)                                  \
-        {                                              \
-            _bin |= (1 << (3 - (index)));              \
-            return true;                               \
-        }                                              \
-        return false;                                  \
-    }
-
-temp(north, 0);
-temp(east, 1);
-temp(south, 2);
-temp(west, 3);
-
-#undef temp
-
-uint8_t Node::bin()
-{
-    return _bin;
-}
-
-Node::operator std::string()
-{
-    char buf[5];
-    sprintf(buf, "%c%c%c%c",
-            ((_bin & 0b1000) ? '1' : '0'),
-            ((_bin & 0b0100) ? '1' : '0'),
-            ((_bin & 0b0010) ? '1' : '0'),
-            ((_bin & 0b0001) ? '1' : '0'));
-    return std::string(buf);
-}
-
-std::ostream &operator<<(std::ostream &os, Node &node)
+template <class Topology>
+std::ostream &operator<<(std::ostream &os, const BasicNode<Topology> &node)
 {
     os << std::string(node);
     return os;
@@ -104,134 +89,163 @@ std::ostream &operator<<(std::ostream &os, Node &node)
 ***************************************/
 #pragma region Maze
 
-Maze::Maze(uint _w, uint _h)
+template <class Topology>
+BasicMaze<Topology>::BasicMaze(uint _w, uint _h, Arena::Pages pages, uint _d) : arena(pages)
 {
     w = _w;
     h = _h;
+    d = Topology::dimensions == 3 ? _d : 1;
+}
+
+template <class Topology>
+uint BasicMaze<Topology>::size() const
+{
+    return w * h * d;
 }
 
-void Maze::load(uint8_t *bin)
+/**
+ * @brief Bytes of the file header: width, height and for 3D topologies depth
+ */
+template <class Topology>
+static size_t header_bytes()
+{
+    return Topology::dimensions * (bLegacy ? 1 : 4);
+}
+
+template <class Topology>
+size_t BasicMaze<Topology>::bytes() const
 {
-    // Make sure that field isn't already pointing to some place in memory
-    if (field)
+    size_t l = size();
+    return header_bytes<Topology>() + (Topology::bits == 4 ? (l + 1) / 2 : l);
+}
+
+/**
+ * @brief Bytes needed for field, changed and the array returned by unload()
+ */
+template <class Topology>
+static size_t maze_bytes(const BasicMaze<Topology> *maze)
+{
+    size_t l = maze->size();
+    return 3 * Arena::alignment + l * sizeof(BasicNode<Topology>) + l * sizeof(bool) + maze->bytes();
+}
+
+template <class Topology>
+bool BasicMaze<Topology>::valid_file(const uint8_t *bin, size_t length) const
+{
+    size_t header = header_bytes<Topology>();
+    if (length < header)
+        return false;
+
+    ulong l = 1;
+    for (uint i = 0; i < Topology::dimensions; ++i)
     {
-        free(field);
-        field = NULL;
+        uint dim = bLegacy ? bin[i] : ((const uint *)bin)[i];
+        if (dim == 0)
+            return false;
+        l *= dim;
+        // Cell indices are uint
+        if (l > (uint)-1)
+            return false;
     }
 
-    // Make sure that changed isn't already pointing to some place in memory
-    if (changed)
+    // The file does not know its topology, an exact size at least tells most of them apart
+    return length - header == (Topology::bits == 4 ? (l + 1) / 2 : l);
+}
+
+template <class Topology>
+void BasicMaze<Topology>::load(uint8_t *bin)
+{
+    // Everything of the previous maze lives in the arena, the memory is reused
+    arena.reset();
+    field = NULL;
+    changed = NULL;
+
+    if (bin)
     {
-        free(changed);
-        changed = NULL;
+        uint dims[3] = {w, h, d};
+        for (uint i = 0; i < Topology::dimensions; ++i)
+        {
+            dims[i] = bLegacy ? bin[0] : ((uint *)bin)[0];
+            bin += bLegacy ? 1 : 4;
+        }
+        w = dims[0];
+        h = dims[1];
+        d = dims[2];
     }
 
+    uint l = size();
+    arena.reserve(maze_bytes(this));
+    field = (BasicNode<Topology> *)arena.allocate(l * sizeof(BasicNode<Topology>));
+    changed = (bool *)arena.allocate(l * sizeof(bool));
+    memset(changed, true, l);
+
     if (!bin)
     {
-        field = (Node *)malloc(w * h * sizeof(Node));
-        changed = (bool *)malloc(w * h * sizeof(bool));
-        memset(changed, true, w * h);
-        for (uint i = 0; i < w * h; ++i)
-            field[i] = Node(0);
+        for (uint i = 0; i < l; ++i)
+            field[i] = BasicNode<Topology>(0);
         return;
     }
 
-    if (bLegacy)
-    {
-        w = bin[0];
-        h = bin[1];
-        bin += 2;
-    }
-    else
+    if (Topology::bits == 8)
     {
-        w = ((uint *)bin)[0];
-        h = ((uint *)bin)[1];
-        bin += 8;
+        for (uint i = 0; i < l; ++i)
+            field[i] = BasicNode<Topology>(bin[i]);
+        return;
     }
 
-    changed = (bool *)malloc(w * h * sizeof(bool));
-    memset(changed, true, w * h);
-
-    uint l = w * h;
-    field = (Node *)malloc(l * sizeof(Node));
-    for (uint i = 0; i < l - 1; i += 2)
+    for (uint i = 0; i + 1 < l; i += 2)
     {
-        char element = bin[i / 2];
-        field[i] = Node((element >> 4) & 0xf);
-        field[i + 1] = Node(element & 0xf);
+        uint8_t element = bin[i / 2];
+        field[i] = BasicNode<Topology>(element >> 4);
+        field[i + 1] = BasicNode<Topology>(element & 0xf);
     }
     if (l % 2 == 1)
-        field[l - 1] = Node(bin[l / 2] >> 4);
+        field[l - 1] = BasicNode<Topology>(bin[l / 2] >> 4);
 }
 
-uint8_t *Maze::unload()
+template <class Topology>
+uint8_t *BasicMaze<Topology>::unload()
 {
-    uint l = w * h;
-    uint8_t *bin = (uint8_t *)malloc(((l + 1) / 2) * sizeof(uint8_t) + (bLegacy ? 2 : 8));
+    uint l = size();
+    uint8_t *bin = (uint8_t *)arena.allocate(bytes());
+    uint8_t *out = bin;
 
-    if (bLegacy)
-    {
-        bin[0] = w;
-        bin[1] = h;
-        bin += 2 * sizeof(uint8_t);
-    }
-    else
+    uint dims[3] = {w, h, d};
+    for (uint i = 0; i < Topology::dimensions; ++i)
     {
-        ((uint *)bin)[0] = w;
-        ((uint *)bin)[1] = h;
-        bin += 8;
+        if (bLegacy)
+            *out = dims[i];
+        else
+            ((uint *)out)[0] = dims[i];
+        out += bLegacy ? 1 : 4;
     }
 
-    uint8_t byte;
-    bool half = false;
-    uint index = 0;
-    for (uint y = 0; y < h; ++y)
+    if (Topology::bits == 8)
     {
-        for (uint x = 0; x < w; ++x)
-        {
-            if (!half)
-            {
-                byte = (field[y * w + x].bin()) << 4;
-                half = true;
-            }
-            else
-            {
-                bin[index++] = byte | field[y * w + x].bin();
-                half = false;
-            }
-        }
+        for (uint i = 0; i < l; ++i)
+            out[i] = field[i].bin();
     }
-    if (half)
+    else
     {
-        bin[index] = byte;
+        for (uint i = 0; i + 1 < l; i += 2)
+            out[i / 2] = (field[i].bin() << 4) | field[i + 1].bin();
+        if (l % 2 == 1)
+            out[l / 2] = field[l - 1].bin() << 4;
     }
-    free(field);
-    free(changed);
+
     field = NULL;
     changed = NULL;
-    return bin - (bLegacy ? 2 : 8);
+    return bin;
 }
 
-void Maze::print()
+template <class Topology>
+void BasicMaze<Topology>::print()
 {
-    std::string top, middle, bottom;
-    for (uint y = 0; y < h; ++y)
-    {
-        top = "";
-        middle = "";
-        bottom = "";
-        for (uint x = 0; x < w; ++x)
-        {
-            Node *n = &field[y * w + x];
-            top += n->north() ? "+  +" : "+--+";
-            middle += n->west() ? "  " : "| ";
-            middle += n->east() ? "  " : " |";
-            bottom += n->south() ? "+  +" : "+--+";
-        }
-        std::cout << top << std::endl
-                  << middle << std::endl
-                  << bottom << std::endl;
-    }
+    if constexpr (std::is_same_v<Topology, Square>)
+        TextRenderer(this, false).render(std::cout);
+    else
+        for (uint i = 0; i < size(); ++i)
+            std::cout << field[i] << ((i + 1) % w ? ' ' : '\n');
 }
 
 #pragma endregion // Maze end
@@ -241,24 +255,30 @@ void Maze::print()
 ***************************************/
 #pragma region Maze Generator
 
-MazeGenerator::MazeGenerator(Maze *_maze, point start)
+template <class Topology>
+BasicMazeGenerator<Topology>::BasicMazeGenerator(BasicMaze<Topology> *_maze, uint start, GenerationLog *_log)
 {
     maze = _maze;
-    stack.push_back({start, {-1, -1}});
+    log = _log;
+    visited.assign(maze->size(), false);
+    stack.push_back({start, (uint)-1, 0});
     std::srand(unsigned(std::time(0)));
 }
 
-bool MazeGenerator::has_next()
+template <class Topology>
+bool BasicMazeGenerator<Topology>::has_next()
 {
     return !stack.empty();
 }
 
-void MazeGenerator::next()
+template <class Topology>
+void BasicMazeGenerator<Topology>::next()
 {
     uint w = maze->w;
     uint h = maze->h;
+    uint d = maze->d;
 
-    std::pair<point, point> top;
+    Step top;
     while (1)
     {
         if (stack.empty())
@@ -266,60 +286,63 @@ void MazeGenerator::next()
 
         top = stack.back();
         stack.pop_back();
-        if (visited.find(top.first) == visited.end())
+        if (!visited[top.cell])
         {
-            visited.insert(top.first);
+            visited[top.cell] = true;
             break;
         }
     }
 
-    if (top.second != point{-1, -1})
+    if (top.parent != (uint)-1)
     {
-        // Update field
-        if (top.first.first > top.second.first) // new is to the east
-        {
-            maze->field[top.second.second * w + top.second.first].east(1);
-            maze->field[top.first.second * w + top.first.first].west(1);
-        }
-        else if (top.first.first < top.second.first) // new is to the west
-        {
-            maze->field[top.second.second * w + top.second.first].west(1);
-            maze->field[top.first.second * w + top.first.first].east(1);
-        }
-        else if (top.first.second < top.second.second) // new is to the north
-        {
-            maze->field[top.second.second * w + top.second.first].north(1);
-            maze->field[top.first.second * w + top.first.first].south(1);
-        }
-        else if (top.first.second > top.second.second) // new is to the south
-        {
-            maze->field[top.second.second * w + top.second.first].south(1);
-            maze->field[top.first.second * w + top.first.first].north(1);
-        }
+        // Update field, the direction was stored when the cell was pushed, so no comparisons are needed
+        maze->field[top.parent].carve(top.direction);
+        maze->field[top.cell].carve(Topology::opposite[top.direction]);
 
-        maze->changed[top.first.second * w + top.first.first] = true;
-        maze->changed[top.second.second * w + top.second.first] = true;
+        maze->changed[top.cell] = true;
+        maze->changed[top.parent] = true;
+
+        if constexpr (std::is_same_v<Topology, Square>)
+            if (log)
+                log->record(top.parent, top.cell);
     }
 
-    std::vector<point> neighbors = {
-        {top.first.first - 1, top.first.second},
-        {top.first.first + 1, top.first.second},
-        {top.first.first, top.first.second - 1},
-        {top.first.first, top.first.second + 1},
-    };
+    uint x = top.cell % w;
+    uint y = top.cell / w % h;
+    uint z = top.cell / w / h;
+    const Offset *offsets = Topology::offsets[Topology::parity(x, y, z)];
 
-    std::random_shuffle(neighbors.begin(), neighbors.end());
+    uint8_t order[Topology::directions];
+    for (uint8_t i = 0; i < Topology::directions; ++i)
+        order[i] = i;
+    std::random_shuffle(order, order + Topology::directions);
 
-    for (auto n : neighbors)
+    for (uint8_t direction : order)
     {
-        if (n.first >= 0 && n.first < w && n.second >= 0 && n.second < h)
-            if (visited.find(n) == visited.end())
-                stack.push_back({n, top.first});
+        uint nx = x + offsets[direction].dx;
+        uint ny = y + offsets[direction].dy;
+        uint nz = z + offsets[direction].dz;
+        // Negative coordinates wrap around and fail the comparison as well
+        if (nx < w && ny < h && nz < d)
+        {
+            uint n = (nz * h + ny) * w + nx;
+            if (!visited[n])
+                stack.push_back({n, top.cell, direction});
+        }
     }
 }
 
 #pragma endregion // Maze Generator end
 
+template class BasicMaze<Square>;
+template class BasicMaze<Hex>;
+template class BasicMaze<Triangle>;
+template class BasicMaze<Cube>;
+template class BasicMazeGenerator<Square>;
+template class BasicMazeGenerator<Hex>;
+template class BasicMazeGenerator<Triangle>;
+template class BasicMazeGenerator<Cube>;
+
 } /* namespace maze */
 #pragma endregion
 
@@ -328,15 +351,42 @@ void print_help(char *progname, uint8_t exit_code = 0)
     std::ostream *stream = exit_code ? &(std::cerr) : &(std::cout);
     *stream
         << "Usage: " << progname << " [options]" << std::endl
+        << "       " << progname << " crop X Y W H INPUT OUTPUT [--verbose]" << std::endl
+        << "       " << progname << " flip h|v INPUT OUTPUT [--verbose]" << std::endl
+        << "       " << progname << " rotate 90|180|270 INPUT OUTPUT [--verbose]" << std::endl
+        << "       " << progname << " stitch COLUMNS INPUT... OUTPUT [--verbose]" << std::endl
+        << std::endl
         << "Options:" << std::endl
         << "  -i PATH, --input=PATH      Read maze from PATH." << std::endl
         << "  -o PATH, --output=PATH     Write maze to PATH." << std::endl
         << "  -x N, --width=N            Set maze width. Get's overriden if maze is generated from file." << std::endl
         << "  -y N, --height=N           Set maze height. Get's overriden if maze is generated from file." << std::endl
+        << "  -z N, --depth=N            Set number of levels of a cube maze. Get's overriden if maze is generated from file." << std::endl
         << "  -s N, --steps=N            Calculation steps per frame of drawing, ignored if -d is not set." << std::endl
         << "  -d, --display              Render maze to an SFML window." << std::endl
         << "  -g, --generate             Generate a random maze using depth first search." << std::endl
         << "  -h, --help                 Print this message and exit." << std::endl
+        << "  --validate                 Check the finished maze for consistency and perfectness, exit with 1 if invalid." << std::endl
+        << "  --analyze                  Like --validate, but also print statistics (dead ends, junctions, corridor lengths)." << std::endl
+        << "  --record=PATH              Write a log of the generation to PATH, requires -g." << std::endl
+        << "  --replay=PATH              Play a generation log from PATH instead of generating. Replaces -i and -g." << std::endl
+        << "  --seek=N                   Start the replay after N steps. Without -d, the maze after N steps is the result." << std::endl
+        << "  --reverse                  Play the replay backwards, starting at the end unless --seek is given." << std::endl
+        << "  --text[=PATH]              Write the finished maze as text to PATH, or to stdout if PATH is omitted or -." << std::endl
+        << "  --unicode                  Use box drawing characters for --text instead of ASCII." << std::endl
+        << "  --query-file=PATH          Print the distance for every line \"x1 y1 x2 y2\" in PATH, -1 if there is no path." << std::endl
+        << "  --query-paths              Also print the cells on each path of --query-file." << std::endl
+        << "  --hugepages=MODE           Back the maze with huge pages: none (default), transparent or explicit." << std::endl
+        << "  --topology=NAME            Shape of the cells: square (default), hex, triangle or cube. Only square mazes" << std::endl
+        << "                             can be displayed, validated, recorded, replayed, queried, written as text or animated." << std::endl
+        << "  --animate=PATH             Write the generation or replay as animated GIF (*.gif) or raw frames to PATH. Replaces -d." << std::endl
+        << "  --every=N                  Steps between two frames of --animate, 1 by default." << std::endl
+        << std::endl
+        << "Transforms (work on files directly, without loading the maze):" << std::endl
+        << "  crop                       Cut out the W x H rectangle at X, Y." << std::endl
+        << "  flip                       Mirror horizontally (h) or vertically (v)." << std::endl
+        << "  rotate                     Rotate clockwise." << std::endl
+        << "  stitch                     Arrange the inputs in a grid, row by row, and connect them into one maze." << std::endl
         << std::endl
         << "Debugging:" << std::endl
         << "  --verbose                  Be verbose." << std::endl
@@ -353,6 +403,185 @@ void draw_rect(sf::RenderWindow *window, int x, int y, int w, int h, sf::Color c
     window->draw(rect);
 }
 
+bool analyze(maze::Maze *m)
+{
+    timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    ulong start_us = t.tv_sec * 1000000 + t.tv_nsec / 1000;
+
+    maze::MazeReport report = maze::MazeAnalyzer(m).run();
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    ulong end_us = t.tv_sec * 1000000 + t.tv_nsec / 1000;
+
+    report.print(bAnalyze);
+    if (verbose_flag)
+        std::cout << "Analysis time: " << ((end_us - start_us) / 1000.f) << " ms" << std::endl;
+
+    return report.perfect();
+}
+
+void save_text(std::string path, maze::Maze *m)
+{
+    if (verbose_flag)
+        std::cout << "Writing text to " << (path == "-" ? "stdout" : path) << std::endl;
+
+    maze::TextRenderer renderer(m, bUnicode);
+    if (path == "-")
+    {
+        renderer.render(std::cout);
+        return;
+    }
+
+    std::ofstream ofs(path, std::ios::trunc);
+    renderer.render(ofs);
+}
+
+int cell_size(uint width, uint height)
+{
+    int csx = MAX_WIDTH / width;
+    int csy = MAX_HEIGHT / height;
+    return std::max(1, std::min(csx, csy));
+}
+
+bool animate(std::string path, maze::Maze *m, maze::MazeGenerator *generator, maze::Replay *replay)
+{
+    maze::Animation animation(m, path, cell_size(m->w, m->h));
+    if (!animation.is_open())
+    {
+        std::cerr << "Invalid path: " << '"' << path << '"' << std::endl;
+        return false;
+    }
+
+    // The first frame shows the maze before the first step
+    animation.capture();
+
+    if (generator)
+    {
+        while (generator->has_next())
+        {
+            for (ulong i = 0; i < animateEvery && generator->has_next(); ++i)
+                generator->next();
+            animation.capture();
+        }
+    }
+
+    if (replay)
+    {
+        ulong target = std::min(seekStep, replay->length());
+        while (replay->position() < target)
+        {
+            replay->seek(std::min(target, replay->position() + animateEvery));
+            animation.capture();
+        }
+    }
+
+    // Hold the finished maze for 3 seconds before the animation starts over
+    animation.capture(300);
+    bool ok = animation.close();
+
+    if (verbose_flag)
+        std::cout << "Animation: " << animation.frames << " frames, " << animation.bytes << " bytes" << std::endl;
+
+    return ok;
+}
+
+bool answer_queries(std::string path, maze::Maze *m)
+{
+    timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    ulong start_us = t.tv_sec * 1000000 + t.tv_nsec / 1000;
+
+    maze::PathIndex index(m);
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    ulong built_us = t.tv_sec * 1000000 + t.tv_nsec / 1000;
+
+    std::ifstream ifs(path);
+    std::string out;
+    std::vector<uint> cells;
+    ulong count = 0;
+    long x1, y1, x2, y2;
+
+    while (ifs >> x1 >> y1 >> x2 >> y2)
+    {
+        ++count;
+        bool inside = x1 >= 0 && x2 >= 0 && x1 < m->w && x2 < m->w &&
+                      y1 >= 0 && y2 >= 0 && y1 < m->h && y2 < m->h;
+        uint a = y1 * m->w + x1;
+        uint b = y2 * m->w + x2;
+
+        out += std::to_string(inside ? index.distance(a, b) : -1);
+        if (bQueryPaths && inside && index.path(a, b, cells))
+        {
+            out += ':';
+            for (uint c : cells)
+                out += ' ' + std::to_string(c % m->w) + ',' + std::to_string(c / m->w);
+        }
+        out += '\n';
+
+        if (out.size() >= 1 << 20)
+        {
+            std::cout << out;
+            out.clear();
+        }
+    }
+    std::cout << out << std::flush;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    ulong end_us = t.tv_sec * 1000000 + t.tv_nsec / 1000;
+
+    if (verbose_flag)
+        std::cout << "Index time: " << ((built_us - start_us) / 1000.f) << " ms" << std::endl
+                  << "Queries: " << count << " in " << ((end_us - built_us) / 1000.f) << " ms" << std::endl;
+
+    if (!ifs.eof())
+    {
+        std::cerr << "Invalid query after line " << count << " in " << '"' << path << '"' << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int run_transform(int argc, char **argv)
+{
+    // --verbose may appear anywhere, everything else is positional
+    std::vector<char *> args;
+    for (int i = 0; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--verbose"))
+            verbose_flag = 1;
+        else
+            args.push_back(argv[i]);
+    }
+    argc = args.size();
+    argv = args.data();
+
+    std::string command = argv[1];
+    bool ok = false;
+    timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    ulong start_us = t.tv_sec * 1000000 + t.tv_nsec / 1000;
+
+    if (command == "crop" && argc == 8)
+        ok = maze::crop_file(argv[6], argv[7], atoi(argv[2]), atoi(argv[3]), atoi(argv[4]), atoi(argv[5]));
+    else if (command == "flip" && argc == 5 && (!strcmp(argv[2], "h") || !strcmp(argv[2], "v")))
+        ok = maze::flip_file(argv[3], argv[4], argv[2][0] == 'h');
+    else if (command == "rotate" && argc == 5)
+        ok = maze::rotate_file(argv[3], argv[4], atoi(argv[2]));
+    else if (command == "stitch" && argc >= 5)
+        ok = maze::stitch_files(std::vector<std::string>(argv + 3, argv + argc - 1), atoi(argv[2]), argv[argc - 1]);
+    else
+        print_help(argv[0], 1);
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    ulong end_us = t.tv_sec * 1000000 + t.tv_nsec / 1000;
+    if (ok && verbose_flag)
+        std::cout << command << ": " << ((end_us - start_us) / 1000.f) << " ms" << std::endl;
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 void save_to_file(std::string path, uint8_t *bin, size_t length)
 {
     if (verbose_flag)
@@ -366,6 +595,85 @@ void save_to_file(std::string path, uint8_t *bin, size_t length)
         std::cout << "Writing successful" << std::endl;
 }
 
+std::vector<char> load_from_file(std::string path)
+{
+    if (verbose_flag)
+        std::cout << "Loading from file " << path << std::endl;
+
+    std::ifstream ifs(path, std::ios::binary | std::ios::ate);
+    std::ifstream::pos_type pos = ifs.tellg();
+
+    std::vector<char> result(pos);
+
+    ifs.seekg(0, std::ios::beg);
+    ifs.read(result.data(), pos);
+
+    if (verbose_flag)
+        std::cout << "Reading successful" << std::endl;
+
+    return result;
+}
+
+template <class Topology>
+int run_topology(uint width, uint height, uint depth)
+{
+    if (bDisplay || bValidate || bAnalyze || record_path.length() || replay_path.length() ||
+        text_path.length() || query_path.length() || animate_path.length())
+        std::cerr << "Only square mazes can be displayed, validated, recorded, replayed, queried, written as text or animated, "
+                  << "ignoring these options for topology " << '"' << Topology::name << '"' << std::endl;
+
+    maze::BasicMaze<Topology> m(width, height, pages, depth);
+
+    if (input_path.length())
+    {
+        std::vector<char> data = load_from_file(input_path);
+        if (!m.valid_file((uint8_t *)data.data(), data.size()))
+        {
+            std::cerr << "Invalid maze file: " << '"' << input_path << '"' << std::endl;
+            return EXIT_FAILURE;
+        }
+        m.load((uint8_t *)data.data());
+
+        if (verbose_flag)
+            std::cout << "size from file: " << m.w << 'x' << m.h << 'x' << m.d << std::endl;
+    }
+    else
+    {
+        m.load(NULL);
+    }
+
+    timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    ulong start_us = t.tv_sec * 1000000 + t.tv_nsec / 1000;
+
+    if (bGenerate)
+    {
+        maze::BasicMazeGenerator<Topology> generator(&m, 0);
+        while (generator.has_next())
+            generator.next();
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    ulong end_us = t.tv_sec * 1000000 + t.tv_nsec / 1000;
+
+    if (verbose_flag)
+    {
+        if (m.w <= 12 && m.h * m.d <= 20)
+            m.print();
+        else
+            std::cout << "Too big to draw..." << std::endl;
+
+        std::cout << "Done!" << std::endl
+                  << "Compute time: " << ((end_us - start_us) / 1000.f) << " ms" << std::endl;
+    }
+
+    uint8_t *bin = m.unload();
+    if (output_path.length())
+        save_to_file(output_path, bin, m.bytes());
+
+    return EXIT_SUCCESS;
+}
+
 /***************************************
 // Main                               //
 ***************************************/
@@ -373,6 +681,14 @@ int main(int argc, char **argv)
 {
     static uint width = 1;
     static uint height = 1;
+    static uint depth = 1;
+
+    int first = 1;
+    while (first < argc && !strcmp(argv[first], "--verbose"))
+        ++first;
+    if (first < argc && (!strcmp(argv[first], "crop") || !strcmp(argv[first], "flip") ||
+                         !strcmp(argv[first], "rotate") || !strcmp(argv[first], "stitch")))
+        return run_transform(argc, argv);
 
 #pragma region Parse command line arguments
 
@@ -386,10 +702,25 @@ int main(int argc, char **argv)
             {
                 {"verbose", no_argument, &verbose_flag, 1},
                 {"legacy", no_argument, &bLegacy, 1},
+                {"validate", no_argument, &bValidate, 1},
+                {"analyze", no_argument, &bAnalyze, 1},
+                {"reverse", no_argument, &bReverse, 1},
+                {"record", required_argument, 0, OPT_RECORD},
+                {"replay", required_argument, 0, OPT_REPLAY},
+                {"seek", required_argument, 0, OPT_SEEK},
+                {"text", optional_argument, 0, OPT_TEXT},
+                {"unicode", no_argument, &bUnicode, 1},
+                {"query-file", required_argument, 0, OPT_QUERY},
+                {"query-paths", no_argument, &bQueryPaths, 1},
+                {"hugepages", required_argument, 0, OPT_HUGEPAGES},
+                {"topology", required_argument, 0, OPT_TOPOLOGY},
+                {"animate", required_argument, 0, OPT_ANIMATE},
+                {"every", required_argument, 0, OPT_EVERY},
                 {"input", required_argument, 0, 'i'},
                 {"output", required_argument, 0, 'o'},
                 {"width", required_argument, 0, 'x'},
                 {"height", required_argument, 0, 'y'},
+                {"depth", required_argument, 0, 'z'},
                 {"steps", required_argument, 0, 's'},
                 {"display", no_argument, 0, 'd'},
                 {"generate", no_argument, 0, 'g'},
@@ -397,7 +728,7 @@ int main(int argc, char **argv)
                 {0, 0, 0, 0}};
         /* getopt_long stores the option index here. */
         int option_index = 0;
-        c = getopt_long(argc, argv, "i:o:x:y:s:dgh", long_options, &option_index);
+        c = getopt_long(argc, argv, "i:o:x:y:z:s:dgh", long_options, &option_index);
         if (c == -1)
             break;
 
@@ -427,6 +758,32 @@ int main(int argc, char **argv)
                 std::cerr << "Invalid path: " << '"' << optarg << '"' << std::endl;
             break;
 
+        case OPT_QUERY:
+            if (std::filesystem::is_regular_file(optarg))
+                query_path = optarg;
+            else
+                std::cerr << "Invalid path: " << '"' << optarg << '"' << std::endl;
+            break;
+
+        case OPT_HUGEPAGES:
+            if (!strcmp(optarg, "none"))
+                pages = maze::Arena::NORMAL;
+            else if (!strcmp(optarg, "transparent"))
+                pages = maze::Arena::TRANSPARENT;
+            else if (!strcmp(optarg, "explicit"))
+                pages = maze::Arena::EXPLICIT;
+            else
+                std::cerr << "Invalid huge page mode: " << '"' << optarg << '"' << std::endl;
+            break;
+
+        case OPT_TOPOLOGY:
+            if (!strcmp(optarg, maze::Square::name) || !strcmp(optarg, maze::Hex::name) ||
+                !strcmp(optarg, maze::Triangle::name) || !strcmp(optarg, maze::Cube::name))
+                topology = optarg;
+            else
+                std::cerr << "Invalid topology: " << '"' << optarg << '"' << std::endl;
+            break;
+
         case 'x':
             parsed = atoi(optarg);
             width = std::clamp(parsed, 1, 1024);
@@ -437,6 +794,11 @@ int main(int argc, char **argv)
             height = std::clamp(parsed, 1, 1024);
             break;
 
+        case 'z':
+            parsed = atoi(optarg);
+            depth = std::clamp(parsed, 1, 1024);
+            break;
+
         case 's':
             parsed = atoi(optarg);
             stepsPerFrame = (uint)std::clamp(parsed, 1, 1024);
@@ -446,6 +808,44 @@ int main(int argc, char **argv)
             bDisplay = true;
             break;
 
+        case OPT_RECORD:
+            if (!std::filesystem::exists(optarg) || std::filesystem::is_regular_file(optarg))
+                record_path = optarg;
+            else
+                std::cerr << "Invalid path: " << '"' << optarg << '"' << std::endl;
+            break;
+
+        case OPT_REPLAY:
+            if (std::filesystem::is_regular_file(optarg))
+                replay_path = optarg;
+            else
+                std::cerr << "Invalid path: " << '"' << optarg << '"' << std::endl;
+            break;
+
+        case OPT_SEEK:
+            seekStep = strtoul(optarg, NULL, 10);
+            break;
+
+        case OPT_ANIMATE:
+            if (!std::filesystem::exists(optarg) || std::filesystem::is_regular_file(optarg))
+                animate_path = optarg;
+            else
+                std::cerr << "Invalid path: " << '"' << optarg << '"' << std::endl;
+            break;
+
+        case OPT_EVERY:
+            animateEvery = std::max(1ul, strtoul(optarg, NULL, 10));
+            break;
+
+        case OPT_TEXT:
+            if (!optarg || !strcmp(optarg, "-"))
+                text_path = "-";
+            else if (!std::filesystem::exists(optarg) || std::filesystem::is_regular_file(optarg))
+                text_path = optarg;
+            else
+                std::cerr << "Invalid path: " << '"' << optarg << '"' << std::endl;
+            break;
+
         case 'g':
             bGenerate = true;
             break;
@@ -462,31 +862,63 @@ int main(int argc, char **argv)
             << "input path: \"" << input_path << '"' << std::endl
             << "output path: \"" << output_path << '"' << std::endl
             << "size: " << width << 'x' << height << std::endl
+            << "topology: " << topology << std::endl
             << "display: " << (bDisplay ? "true" : "false") << std::endl
-            << "generate: " << (bGenerate ? "true" : "false") << std::endl;
+            << "generate: " << (bGenerate ? "true" : "false") << std::endl
+            << "validate: " << (bValidate || bAnalyze ? "true" : "false") << std::endl
+            << "record path: \"" << record_path << '"' << std::endl
+            << "replay path: \"" << replay_path << '"' << std::endl
+            << "animate path: \"" << animate_path << '"' << std::endl;
+
+    // Animations are rendered without a window
+    if (animate_path.length())
+        bDisplay = false;
 
 #pragma endregion
 
-    maze::Maze m(width, height);
+    if (topology == maze::Hex::name)
+        return run_topology<maze::Hex>(width, height, depth);
+    if (topology == maze::Triangle::name)
+        return run_topology<maze::Triangle>(width, height, depth);
+    if (topology == maze::Cube::name)
+        return run_topology<maze::Cube>(width, height, depth);
+
+    maze::Maze m(width, height, pages);
+    maze::GenerationLog log;
+    maze::Replay *replay = NULL;
 
 #pragma region Maze initialization
-    // Read from file
-    if (input_path.length())
+    // Play generation log
+    if (replay_path.length())
     {
         if (verbose_flag)
-            std::cout << "Loading from file " << input_path << std::endl;
-
-        std::ifstream ifs(input_path, std::ios::binary | std::ios::ate);
-        std::ifstream::pos_type pos = ifs.tellg();
+            std::cout << "Loading generation log " << replay_path << std::endl;
 
-        std::vector<char> result(pos);
+        if (!log.load(replay_path))
+        {
+            std::cerr << "Invalid generation log: " << '"' << replay_path << '"' << std::endl;
+            return EXIT_FAILURE;
+        }
 
-        ifs.seekg(0, std::ios::beg);
-        ifs.read(result.data(), pos);
+        m.w = width = log.w;
+        m.h = height = log.h;
+        m.load(NULL);
+        replay = new maze::Replay(&m, &log);
+        bGenerate = false;
 
         if (verbose_flag)
-            std::cout << "Reading successful" << std::endl;
-
+            std::cout << "size from log: " << width << 'x' << height << std::endl
+                      << "steps in log: " << replay->length() << std::endl;
+    }
+    // Read from file
+    else if (input_path.length())
+    {
+        std::vector<char> result = load_from_file(input_path);
+        if (!m.valid_file((uint8_t *)result.data(), result.size()))
+        {
+            std::cerr << "Invalid maze file: " << '"' << input_path << '"' << std::endl;
+            return EXIT_FAILURE;
+        }
         m.load((uint8_t *)result.data());
         width = m.w;
         height = m.h;
@@ -502,13 +934,21 @@ int main(int argc, char **argv)
         m.load(NULL);
     }
 
+    if (verbose_flag)
+        std::cout << "Memory: " << (m.arena.capacity() >> 20) << " MiB, fault-in time: "
+                  << (m.arena.fault_time_us() / 1000.f) << " ms (" << m.arena.fault_count() << " page faults)" << std::endl;
+
     DEBUG("Made it past Maze init")
 
 #pragma endregion
 
     maze::MazeGenerator *generator = NULL;
     if (bGenerate)
-        generator = new maze::MazeGenerator(&m, {0, 0});
+    {
+        if (record_path.length())
+            log = maze::GenerationLog(&m, 0);
+        generator = new maze::MazeGenerator(&m, 0, record_path.length() ? &log : NULL);
+    }
 
     if (!bDisplay)
     {
@@ -516,9 +956,20 @@ int main(int argc, char **argv)
         clock_gettime(CLOCK_MONOTONIC, &t);
         ulong start_us = t.tv_sec * 1000000 + t.tv_nsec / 1000;
 
-        if (bGenerate)
-            while (generator->has_next())
-                generator->next();
+        bool animated = true;
+        if (animate_path.length())
+        {
+            animated = animate(animate_path, &m, generator, replay);
+        }
+        else
+        {
+            if (bGenerate)
+                while (generator->has_next())
+                    generator->next();
+
+            if (replay)
+                replay->seek(seekStep);
+        }
 
         clock_gettime(CLOCK_MONOTONIC, &t);
         ulong end_us = t.tv_sec * 1000000 + t.tv_nsec / 1000;
@@ -535,12 +986,24 @@ int main(int argc, char **argv)
                       << "Compute time: " << (calc_time_us / 1000.f) << " ms" << std::endl;
         }
 
+        if (bGenerate && record_path.length())
+            log.save(record_path);
+
+        if (text_path.length())
+            save_text(text_path, &m);
+
+        bool valid = !(bValidate || bAnalyze) || analyze(&m);
+        if (query_path.length())
+            valid &= answer_queries(query_path, &m);
+        valid &= animated;
+
         uint8_t *bin = m.unload();
         if (output_path.length())
-            save_to_file(output_path, bin, (bLegacy ? 2 : 8) + (width * height + 1) / 2);
-        free(bin);
+            save_to_file(output_path, bin, m.bytes());
+        delete generator;
+        delete replay;
 
-        return EXIT_SUCCESS;
+        return valid ? EXIT_SUCCESS : EXIT_FAILURE;
     }
 
 /***************************************
@@ -548,12 +1011,7 @@ int main(int argc, char **argv)
 ***************************************/
 #pragma region SFML Window
 
-    int cellSize = 3;
-    {
-        int csx = MAX_WIDTH / width;
-        int csy = MAX_HEIGHT / height;
-        cellSize = std::max(1, std::min(csx, csy));
-    }
+    int cellSize = cell_size(width, height);
 
     int wall_thickness = std::max(1, cellSize / 16);
     int wall_length = std::max(1, cellSize - 2 * wall_thickness);
@@ -581,6 +1039,9 @@ int main(int argc, char **argv)
 
     int redrawIndex = 0;
 
+    if (replay)
+        replay->seek(seekStep != -1ul ? seekStep : bReverse ? replay->length() : 0);
+
     DEBUG("Created Window")
     DEBUG("CellSize: " << cellSize)
     DEBUG("Wall Thickness: " << wall_thickness)
@@ -592,6 +1053,36 @@ int main(int argc, char **argv)
         {
             if (event.type == sf::Event::Closed)
                 window->close();
+
+            // Replay controls: arrows left and right set the direction, up and down the speed
+            if (event.type == sf::Event::KeyPressed)
+            {
+                switch (event.key.code)
+                {
+                case sf::Keyboard::Left:
+                    bReverse = 1;
+                    break;
+                case sf::Keyboard::Right:
+                    bReverse = 0;
+                    break;
+                case sf::Keyboard::Up:
+                    stepsPerFrame = std::min(stepsPerFrame * 2, 1u << 24);
+                    break;
+                case sf::Keyboard::Down:
+                    stepsPerFrame = std::max(stepsPerFrame / 2, 1u);
+                    break;
+                case sf::Keyboard::Home:
+                    if (replay)
+                        replay->seek(0);
+                    break;
+                case sf::Keyboard::End:
+                    if (replay)
+                        replay->seek(replay->length());
+                    break;
+                default:
+                    break;
+                }
+            }
         }
 
         // Calculate fps
@@ -658,6 +1149,10 @@ int main(int argc, char **argv)
             if (bGenerate && generator->has_next())
                 generator->next();
 
+        if (replay)
+            replay->seek(bReverse ? replay->position() - std::min((ulong)stepsPerFrame, replay->position())
+                                  : replay->position() + stepsPerFrame);
+
         // Wait remaining time to keep fps constant
         {
             clock_gettime(CLOCK_MONOTONIC, &curr_time);
@@ -674,15 +1169,25 @@ int main(int argc, char **argv)
         while (generator->has_next())
             generator->next();
 
+    if (bGenerate && record_path.length())
+        log.save(record_path);
+
+    if (text_path.length())
+        save_text(text_path, &m);
+
+    bool valid = !(bValidate || bAnalyze) || analyze(&m);
+    if (query_path.length())
+        valid &= answer_queries(query_path, &m);
+
     uint8_t *bin = m.unload();
     if (output_path.length())
-        save_to_file(output_path, bin, (bLegacy ? 2 : 8) + (width * height + 1) / 2);
-    free(bin);
+        save_to_file(output_path, bin, m.bytes());
     delete generator;
+    delete replay;
     delete window;
 
 // SFML Window end
 #pragma endregion
 
-    return EXIT_SUCCESS;
+    return valid ? EXIT_SUCCESS : EXIT_FAILURE;
 }
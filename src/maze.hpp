@@ -1,52 +1,78 @@
+#pragma once
+
 #include <iostream>
 #include <unistd.h>
 #include <string>
-#include <unordered_set>
-#include <boost/functional/hash.hpp>
+#include <vector>
 #include <SFML/Graphics.hpp>
 
+#include "arena.hpp"
+#include "topology.hpp"
+
 #pragma region namespace maze
 namespace maze
 {
-class Node
+template <class Topology>
+class BasicNode
 {
 private:
-    uint8_t _bin; /// Connection bitfield (north, east, south, west)
+    uint8_t _bin; /// Connection bitfield, one bit per direction of the Topology, the first direction in the highest bit
 
 public:
+    /**
+     * @brief Bit of a direction in the connection bitfield
+     */
+    static constexpr uint8_t bit(uint8_t direction) { return 1 << (Topology::directions - 1 - direction); }
+
     /**
      * @brief Construct a new Node object
      * 
      * @param    bin                 Connection bitfield
      */
-    Node(uint8_t bin);
+    BasicNode(uint8_t bin) : _bin(bin) {}
 
-#define temp(name) \
-    bool name(uint8_t val);
+    /**
+     * @return true if there is a passage in direction
+     */
+    bool has(uint8_t direction) const { return _bin & bit(direction); }
 
-    temp(north);
-    temp(east);
-    temp(south);
-    temp(west);
-#undef temp
+    /**
+     * @brief Open the passage in direction
+     */
+    void carve(uint8_t direction) { _bin |= bit(direction); }
+
+    // Only available for topologies that have these directions
+    bool north() const { return has(Topology::NORTH); }
+    bool east() const { return has(Topology::EAST); }
+    bool south() const { return has(Topology::SOUTH); }
+    bool west() const { return has(Topology::WEST); }
 
     /**
      * @brief Getter for _bin
      * 
      * @return uint8_t Connection bitfield
      */
-    uint8_t bin();
+    uint8_t bin() const { return _bin; }
 
-    operator std::string();
+    operator std::string() const
+    {
+        std::string s;
+        for (uint d = 0; d < Topology::directions; ++d)
+            s += has(d) ? '1' : '0';
+        return s;
+    }
 };
 
-class Maze
+template <class Topology>
+class BasicMaze
 {
 public:
-    uint w;               /// Width
-    uint h;               /// Height
-    Node *field = NULL;   /// Contains all Nodes of the maze
-    bool *changed = NULL; /// Stores for each Node, if it has changed, so that only changed Nodes are drawn to the screen
+    uint w;                                /// Width
+    uint h;                                /// Height
+    uint d;                                /// Depth, number of levels. Always 1 for 2D topologies
+    BasicNode<Topology> *field = NULL;     /// Contains all Nodes of the maze, level by level, row by row
+    bool *changed = NULL;                  /// Stores for each Node, if it has changed, so that only changed Nodes are drawn to the screen
+    Arena arena;                           /// Owns field, changed and the array returned by unload()
 
 public:
     /**
@@ -54,46 +80,82 @@ public:
      * 
      * @param    _w                  width
      * @param    _h                  height
+     * @param    pages               Page size of the memory for field and changed
+     * @param    _d                  depth, ignored for 2D topologies
      */
-    Maze(uint _w, uint _h);
+    BasicMaze(uint _w, uint _h, Arena::Pages pages = Arena::NORMAL, uint _d = 1);
+
+    BasicMaze(const BasicMaze &) = delete;
+    BasicMaze &operator=(const BasicMaze &) = delete;
 
     /**
-     * @brief Allocate space for field and load field from binay array: { w, h, ...}
+     * @return uint                  Number of Nodes
+     */
+    uint size() const;
+
+    /**
+     * @return size_t                Size of the array returned by unload()
+     */
+    size_t bytes() const;
+
+    /**
+     * @brief Check a binary array before it is passed to load()
+     * 
+     * @param    bin                 Binary array containing data
+     * @param    length              Size of bin
+     * @return true if the header describes a non-empty maze and bin contains exactly its Nodes
+     */
+    bool valid_file(const uint8_t *bin, size_t length) const;
+
+    /**
+     * @brief Allocate space for field and load field from binay array: { w, h, [d,] ...}
+     *        Memory of the previous maze is reused.
      * 
      * @param    bin                 Binary array containing data
      */
     void load(uint8_t *bin);
 
     /**
-     * @brief store field in binary array, free field
+     * @brief store field in binary array, release field
      * 
-     * @return  uint8_t*            Binary array containing data
+     * @return  uint8_t*            Binary array containing data, owned by the maze and valid until the next load()
      */
     uint8_t *unload();
 
     /**
-     * @brief Prints the maze into the console
+     * @brief Prints the maze into the console, only square mazes can be printed
      */
     void print();
 };
 
-class MazeGenerator
+class GenerationLog;
+class Replay;
+
+template <class Topology>
+class BasicMazeGenerator
 {
 private:
-    typedef std::pair<int, int> point;
+    struct Step
+    {
+        uint cell;         /// Cell to visit
+        uint parent;       /// Visited neighbor that pushed the cell, -1 for the start
+        uint8_t direction; /// Direction from parent to cell
+    };
 
-    Maze *maze;                                            /// Pointer to maze::Maze object that should be generated
-    std::vector<std::pair<point, point>> stack;            /// Contains next points and their parents
-    std::unordered_set<point, boost::hash<point>> visited; /// Contains all visited points
+    BasicMaze<Topology> *maze; /// Pointer to maze::Maze object that should be generated
+    GenerationLog *log;        /// Records every carve if not NULL, only for square mazes
+    std::vector<Step> stack;   /// Contains next cells and their parents
+    std::vector<bool> visited; /// Stores for each cell if it has been visited
 
 public:
     /**
      * @brief Construct a new Maze Generator object
      * 
      * @param    _maze               Pointer to maze::Maze object
-     * @param    start               Starting position
+     * @param    start               Index of the starting cell
+     * @param    _log                Pointer to maze::GenerationLog object that records every carve, or NULL
      */
-    MazeGenerator(Maze *_maze, point start);
+    BasicMazeGenerator(BasicMaze<Topology> *_maze, uint start, GenerationLog *_log = NULL);
 
     /**
      * @brief to be called before next()
@@ -107,6 +169,10 @@ public:
      */
     void next();
 };
+
+typedef BasicNode<Square> Node;
+typedef BasicMaze<Square> Maze;
+typedef BasicMazeGenerator<Square> MazeGenerator;
 } // namespace maze
 #pragma endregion
 
@@ -130,6 +196,71 @@ void print_help(char *progname, uint8_t exit_code);
  */
 void draw_rect(sf::RenderWindow *window, int x, int y, int w, int h, sf::Color color);
 
+/**
+ * @brief Validates the maze and prints the report, statistics are included if --analyze is set
+ * 
+ * @param    m                   maze::Maze object, field has to be loaded
+ * @return true if the maze is perfect
+ */
+bool analyze(maze::Maze *m);
+
+/**
+ * @brief Renders the maze as text, see --text and --unicode
+ * 
+ * @param    path                Path to the file to write to, "-" for stdout
+ * @param    m                   maze::Maze object, field has to be loaded
+ */
+void save_text(std::string path, maze::Maze *m);
+
+/**
+ * @brief Edge length of a cell in pixels, so that the maze fits into MAX_WIDTH x MAX_HEIGHT
+ */
+int cell_size(uint width, uint height);
+
+/**
+ * @brief Runs the generator or replay to the end and writes every --every steps a frame, see --animate
+ * 
+ * @param    path                Path to the file to write to
+ * @param    m                   maze::Maze object, field has to be loaded
+ * @param    generator           Generator to run, or NULL
+ * @param    replay              Replay to play until --seek, or NULL
+ * @return true if the animation was written
+ */
+bool animate(std::string path, maze::Maze *m, maze::MazeGenerator *generator, maze::Replay *replay);
+
+/**
+ * @brief Answers path queries from a file and prints one line per query to stdout
+ * 
+ * Every query is a line of four numbers: x1 y1 x2 y2. The answer is the distance between the two
+ * cells, -1 if there is no path. If --query-paths is set, the cells of the path follow as x,y pairs.
+ * 
+ * @param    path                Path to the query file
+ * @param    m                   maze::Maze object, field has to be loaded
+ * @return true if all queries could be parsed
+ */
+bool answer_queries(std::string path, maze::Maze *m);
+
+/**
+ * @brief Runs one of the transform commands (crop, flip, rotate, stitch) and exits
+ * 
+ * @param    argc                Argument count of main
+ * @param    argv                Arguments of main, argv[1] is the command, --verbose prints the time taken
+ * @return int                  exit code
+ */
+int run_transform(int argc, char **argv);
+
+/**
+ * @brief Loads, generates and saves a maze of a topology other than maze::Square
+ * 
+ * @tparam   Topology            maze::Hex, maze::Triangle or maze::Cube
+ * @param    width               Width, overriden by -i
+ * @param    height              Height, overriden by -i
+ * @param    depth               Number of levels, only used by 3D topologies
+ * @return int                  exit code
+ */
+template <class Topology>
+int run_topology(uint width, uint height, uint depth);
+
 /**
  * @brief Saves byte Array to file
  * 
@@ -137,4 +268,12 @@ void draw_rect(sf::RenderWindow *window, int x, int y, int w, int h, sf::Color c
  * @param    bin                 byte array
  * @param    length              size of bin
  */
-void save_to_file(std::string path, uint8_t *bin, size_t length);
\ No newline at end of file
+void save_to_file(std::string path, uint8_t *bin, size_t length);
+
+/**
+ * @brief Reads a whole file into memory
+ * 
+ * @param    path                Path to the file to read from
+ * @return std::vector<char>    Contents of the file
+ */
+std::vector<char> load_from_file(std::string path);
\ No newline at end of file
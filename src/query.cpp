@@ -0,0 +1,128 @@
+/**
+ * @file query.cpp
+ * @author Maxi Barmetler (https://github.com/MixusMinimax)
+ * @brief Answers path queries on Mazes.
+ * @version 0.1
+ * @date 2020-04-11
+ */
+
+#include <algorithm>
+
+#include "query.hpp"
+
+#pragma region namespace maze
+namespace maze
+{
+PathIndex::PathIndex(Maze *maze)
+{
+    w = maze->w;
+    uint h = maze->h;
+    uint l = w * h;
+
+    parent.assign(l, -1u);
+    depth.assign(l, 0);
+    head.assign(l, 0);
+    root.assign(l, 0);
+
+    // Breadth first order, so that every parent comes before its children
+    std::vector<uint> order;
+    order.reserve(l);
+    for (uint r = 0; r < l; ++r)
+    {
+        if (parent[r] != -1u)
+            continue;
+
+        parent[r] = r;
+        root[r] = r;
+        order.push_back(r);
+        for (size_t i = order.size() - 1; i < order.size(); ++i)
+        {
+            uint v = order[i];
+            uint x = v % w;
+            uint y = v / w;
+            Node *n = &maze->field[v];
+
+            uint next[4];
+            uint k = 0;
+            if (n->north() && y > 0 && maze->field[v - w].south())
+                next[k++] = v - w;
+            if (n->east() && x + 1 < w && maze->field[v + 1].west())
+                next[k++] = v + 1;
+            if (n->south() && y + 1 < h && maze->field[v + w].north())
+                next[k++] = v + w;
+            if (n->west() && x > 0 && maze->field[v - 1].east())
+                next[k++] = v - 1;
+
+            for (uint j = 0; j < k; ++j)
+            {
+                if (parent[next[j]] != -1u)
+                    continue;
+                parent[next[j]] = v;
+                depth[next[j]] = depth[v] + 1;
+                root[next[j]] = r;
+                order.push_back(next[j]);
+            }
+        }
+    }
+
+    // Subtree sizes bottom up, then every cell continues the heavy path of its parent if it is the largest child
+    std::vector<uint> size(l, 1);
+    std::vector<uint> heavy(l, -1u);
+    for (size_t i = l; i-- > 0;)
+    {
+        uint v = order[i];
+        uint p = parent[v];
+        if (p == v)
+            continue;
+        size[p] += size[v];
+        if (heavy[p] == -1u || size[v] > size[heavy[p]])
+            heavy[p] = v;
+    }
+    for (uint v : order)
+        head[v] = (parent[v] != v && heavy[parent[v]] == v) ? head[parent[v]] : v;
+}
+
+uint PathIndex::size() const
+{
+    return parent.size();
+}
+
+uint PathIndex::lca(uint a, uint b) const
+{
+    while (head[a] != head[b])
+    {
+        if (depth[head[a]] > depth[head[b]])
+            a = parent[head[a]];
+        else
+            b = parent[head[b]];
+    }
+    return depth[a] < depth[b] ? a : b;
+}
+
+long PathIndex::distance(uint a, uint b) const
+{
+    if (a >= size() || b >= size() || root[a] != root[b])
+        return -1;
+    return (long)depth[a] + depth[b] - 2 * (long)depth[lca(a, b)];
+}
+
+bool PathIndex::path(uint a, uint b, std::vector<uint> &path) const
+{
+    path.clear();
+    if (a >= size() || b >= size() || root[a] != root[b])
+        return false;
+
+    uint c = lca(a, b);
+    for (; a != c; a = parent[a])
+        path.push_back(a);
+    path.push_back(c);
+
+    size_t middle = path.size();
+    for (; b != c; b = parent[b])
+        path.push_back(b);
+    std::reverse(path.begin() + middle, path.end());
+    return true;
+}
+
+} /* namespace maze */
+#pragma endregion
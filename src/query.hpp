@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+
+#include "maze.hpp"
+
+#pragma region namespace maze
+namespace maze
+{
+/**
+ * @brief Answers distance and path queries between cells of a Maze.
+ *
+ * Built once per maze: every cell gets its parent and depth in a spanning tree rooted at cell 0,
+ * and the tree is split into heavy paths. The lowest common ancestor of two cells is found by
+ * jumping along at most O(log n) heavy paths, which gives the distance without searching the maze.
+ * Generated mazes are trees, so the tree path is the only path. If the maze has loops, the answer
+ * is a valid but not necessarily the shortest path; cells in different components have no path.
+ */
+class PathIndex
+{
+private:
+    uint w;                    /// Width of the maze
+    std::vector<uint> parent;  /// Parent of each cell, roots are their own parent
+    std::vector<uint> depth;   /// Number of passages between each cell and its root
+    std::vector<uint> head;    /// Topmost cell of the heavy path each cell is on
+    std::vector<uint> root;    /// Root of the tree each cell is in
+
+public:
+    /**
+     * @brief Construct a new Path Index object
+     *
+     * @param    maze                Pointer to maze::Maze object, field has to be loaded.
+     *                               Only passages set on both sides are followed.
+     */
+    PathIndex(Maze *maze);
+
+    /**
+     * @brief Number of cells in the maze
+     */
+    uint size() const;
+
+    /**
+     * @brief Lowest common ancestor of two cells in O(log n)
+     *
+     * @param    a                   Cell index
+     * @param    b                   Cell index, has to be in the same component as a
+     * @return uint                  Cell index of the lowest common ancestor
+     */
+    uint lca(uint a, uint b) const;
+
+    /**
+     * @brief Length of the path between two cells in O(log n)
+     *
+     * @param    a                   Cell index
+     * @param    b                   Cell index
+     * @return long                  Number of passages on the path, -1 if there is none
+     */
+    long distance(uint a, uint b) const;
+
+    /**
+     * @brief Cells on the path between two cells, in time proportional to the length of the path
+     *
+     * @param    a                   Cell index of the first cell of the path
+     * @param    b                   Cell index of the last cell of the path
+     * @param    path                Filled with all cell indices from a to b, both included
+     * @return true if there is a path
+     */
+    bool path(uint a, uint b, std::vector<uint> &path) const;
+};
+} // namespace maze
+#pragma endregion
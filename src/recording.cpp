@@ -0,0 +1,412 @@
+/**
+ * @file recording.cpp
+ * @author Maxi Barmetler (https://github.com/MixusMinimax)
+ * @brief Records maze generation and plays it back.
+ * @version 0.1
+ * @date 2020-04-11
+ */
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <string.h>
+
+#include "recording.hpp"
+
+#define MAGIC "MZLG"
+
+#pragma region namespace maze
+namespace maze
+{
+/**
+ * @brief Direction from parent to child: 0 north, 1 east, 2 south, 3 west
+ */
+static uint8_t direction(uint parent, uint child, uint w)
+{
+    // Vertical first, if w is 1 the horizontal neighbors would otherwise match as well
+    if (child + w == parent)
+        return 0;
+    if (parent + w == child)
+        return 2;
+    return child > parent ? 1 : 3;
+}
+
+/**
+ * @brief Map the offset between two cells to a single number that is small if the cells are close.
+ *        dx and dy are zigzag encoded and their bits interleaved.
+ */
+static ulong encode_offset(int dx, int dy)
+{
+    ulong zx = ((uint)dx << 1) ^ (uint)(dx >> 31);
+    ulong zy = ((uint)dy << 1) ^ (uint)(dy >> 31);
+    ulong v = 0;
+    for (uint bit = 0; zx || zy; bit += 2, zx >>= 1, zy >>= 1)
+        v |= ((zx & 1) << bit) | ((zy & 1) << (bit + 1));
+    return v;
+}
+
+/**
+ * @brief Inverse of encode_offset()
+ */
+static void decode_offset(ulong v, int &dx, int &dy)
+{
+    uint zx = 0, zy = 0;
+    for (uint bit = 0; v; ++bit, v >>= 2)
+    {
+        zx |= (v & 1) << bit;
+        zy |= ((v >> 1) & 1) << bit;
+    }
+    dx = (int)(zx >> 1) ^ -(int)(zx & 1);
+    dy = (int)(zy >> 1) ^ -(int)(zy & 1);
+}
+
+/***************************************
+// Generation Log                     //
+***************************************/
+#pragma region Generation Log
+
+GenerationLog::GenerationLog()
+{
+    w = 0;
+    h = 0;
+    start = 0;
+    last = 0;
+}
+
+GenerationLog::GenerationLog(Maze *maze, uint _start)
+{
+    w = maze->w;
+    h = maze->h;
+    start = _start;
+    last = _start;
+
+    uint l = w * h;
+    initial.assign((l + 1) / 2, 0);
+    bool empty = true;
+    for (uint i = 0; i < l; ++i)
+    {
+        initial[i / 2] |= maze->field[i].bin() << ((i % 2) ? 0 : 4);
+        empty &= !maze->field[i].bin();
+    }
+    // An empty field is the common case and does not need to be stored
+    if (empty)
+        initial.clear();
+}
+
+void GenerationLog::record(uint parent, uint child)
+{
+    if (length % interval == 0)
+        keyframes.push_back({jumps.size(), last});
+
+    if (length % 4 == 0)
+        directions.push_back(0);
+    if (length % 8 == 0)
+        flags.push_back(0);
+
+    directions.back() |= direction(parent, child, w) << (6 - 2 * (length % 4));
+    if (parent != last)
+    {
+        flags.back() |= 0x80 >> (length % 8);
+        ulong v = encode_offset((int)(parent % w) - (int)(last % w), (int)(parent / w) - (int)(last / w));
+        for (;; v >>= 7)
+        {
+            if (v < 0x80)
+            {
+                jumps.push_back(v);
+                break;
+            }
+            jumps.push_back((v & 0x7f) | 0x80);
+        }
+    }
+
+    last = child;
+    ++length;
+}
+
+uint GenerationLog::decode(ulong i, ulong &offset, uint &cell) const
+{
+    uint parent = cell;
+    if (flags[i / 8] & (0x80 >> (i % 8)))
+    {
+        ulong v = 0;
+        for (uint shift = 0;; shift += 7)
+        {
+            uint8_t byte = jumps[offset++];
+            v |= (ulong)(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                break;
+        }
+        int dx, dy;
+        decode_offset(v, dx, dy);
+        parent = cell + dy * (int)w + dx;
+    }
+
+    switch ((directions[i / 4] >> (6 - 2 * (i % 4))) & 3)
+    {
+    case 0:
+        cell = parent - w;
+        break;
+    case 1:
+        cell = parent + 1;
+        break;
+    case 2:
+        cell = parent + w;
+        break;
+    default:
+        cell = parent - 1;
+    }
+    return parent;
+}
+
+void GenerationLog::save(std::string path) const
+{
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+
+    uint initial_length = initial.size();
+    ulong jumps_length = jumps.size();
+    ulong keyframes_length = keyframes.size();
+
+    ofs.write(MAGIC, 4);
+    ofs.write((char *)&w, 4);
+    ofs.write((char *)&h, 4);
+    ofs.write((char *)&start, 4);
+    ofs.write((char *)&interval, 4);
+    ofs.write((char *)&length, 8);
+    ofs.write((char *)&initial_length, 4);
+    ofs.write((char *)&jumps_length, 8);
+    ofs.write((char *)&keyframes_length, 8);
+    ofs.write((char *)initial.data(), initial.size());
+    ofs.write((char *)directions.data(), directions.size());
+    ofs.write((char *)flags.data(), flags.size());
+    ofs.write((char *)jumps.data(), jumps.size());
+    for (auto &k : keyframes)
+    {
+        ofs.write((char *)&k.offset, 8);
+        ofs.write((char *)&k.cell, 4);
+    }
+}
+
+bool GenerationLog::load(std::string path)
+{
+    std::ifstream ifs(path, std::ios::binary | std::ios::ate);
+    ulong size = ifs.tellg();
+    ifs.seekg(0, std::ios::beg);
+
+    char magic[4];
+    uint initial_length;
+    ulong jumps_length, keyframes_length;
+
+    ifs.read(magic, 4);
+    if (!ifs || memcmp(magic, MAGIC, 4))
+        return false;
+
+    ifs.read((char *)&w, 4);
+    ifs.read((char *)&h, 4);
+    ifs.read((char *)&start, 4);
+    ifs.read((char *)&interval, 4);
+    ifs.read((char *)&length, 8);
+    ifs.read((char *)&initial_length, 4);
+    ifs.read((char *)&jumps_length, 8);
+    ifs.read((char *)&keyframes_length, 8);
+    if (!ifs || !interval || keyframes_length != (length + interval - 1) / interval)
+        return false;
+    if (initial_length && initial_length != ((ulong)w * h + 1) / 2)
+        return false;
+    // The counts come from the file, check them against its size before allocating anything
+    ulong header = ifs.tellg();
+    if (length / 4 > size || jumps_length > size || keyframes_length > size ||
+        (length + 3) / 4 + (length + 7) / 8 + jumps_length + 12 * keyframes_length + initial_length != size - header)
+        return false;
+
+    initial.resize(initial_length);
+    directions.resize((length + 3) / 4);
+    flags.resize((length + 7) / 8);
+    jumps.resize(jumps_length);
+    keyframes.resize(keyframes_length);
+
+    ifs.read((char *)initial.data(), initial.size());
+    ifs.read((char *)directions.data(), directions.size());
+    ifs.read((char *)flags.data(), flags.size());
+    ifs.read((char *)jumps.data(), jumps.size());
+    for (auto &k : keyframes)
+    {
+        ifs.read((char *)&k.offset, 8);
+        ifs.read((char *)&k.cell, 4);
+    }
+
+    last = start;
+    return ifs && verify();
+}
+
+bool GenerationLog::verify() const
+{
+    ulong l = (ulong)w * h;
+    if (l == 0 || l > (uint)-1 || start >= l)
+        return false;
+    for (auto &k : keyframes)
+        if (k.offset > jumps.size() || k.cell >= l)
+            return false;
+
+    // Same as decode(), but every step is checked, so that seek() can trust the log
+    ulong offset = 0;
+    uint cell = start;
+    for (ulong i = 0; i < length; ++i)
+    {
+        if (i % interval == 0 && (keyframes[i / interval].offset != offset || keyframes[i / interval].cell != cell))
+            return false;
+
+        long x = cell % w;
+        long y = cell / w;
+        if (flags[i / 8] & (0x80 >> (i % 8)))
+        {
+            ulong v = 0;
+            for (uint shift = 0;; shift += 7)
+            {
+                if (offset >= jumps.size() || shift > 63)
+                    return false;
+                uint8_t byte = jumps[offset++];
+                v |= (ulong)(byte & 0x7f) << shift;
+                if (!(byte & 0x80))
+                    break;
+            }
+            int dx, dy;
+            decode_offset(v, dx, dy);
+            x += dx;
+            y += dy;
+            if (x < 0 || y < 0 || x >= w || y >= h)
+                return false;
+        }
+
+        switch ((directions[i / 4] >> (6 - 2 * (i % 4))) & 3)
+        {
+        case 0:
+            --y;
+            break;
+        case 1:
+            ++x;
+            break;
+        case 2:
+            ++y;
+            break;
+        default:
+            --x;
+        }
+        if (x < 0 || y < 0 || x >= w || y >= h)
+            return false;
+        cell = y * w + x;
+    }
+    return true;
+}
+
+#pragma endregion // Generation Log end
+
+/***************************************
+// Replay                             //
+***************************************/
+#pragma region Replay
+
+Replay::Replay(Maze *_maze, const GenerationLog *_log)
+{
+    maze = _maze;
+    log = _log;
+    cell = log->start;
+
+    uint l = maze->w * maze->h;
+    for (uint i = 0; i < l; ++i)
+    {
+        maze->field[i] = Node(initial(i));
+        maze->changed[i] = true;
+    }
+}
+
+uint8_t Replay::initial(uint i) const
+{
+    if (log->initial.empty())
+        return 0;
+    return (log->initial[i / 2] >> ((i % 2) ? 0 : 4)) & 0xf;
+}
+
+void Replay::apply(uint parent, uint child, bool carve)
+{
+    uint8_t d = direction(parent, child, maze->w);
+    uint8_t bits[2] = {(uint8_t)(0b1000 >> d), (uint8_t)(0b1000 >> ((d + 2) % 4))};
+    uint cells[2] = {parent, child};
+
+    for (int k = 0; k < 2; ++k)
+    {
+        uint i = cells[k];
+        uint8_t bin = maze->field[i].bin();
+        if (carve)
+            bin |= bits[k];
+        else
+            // Passages that were there before generation stay
+            bin = (bin & ~bits[k]) | (initial(i) & bits[k]);
+        maze->field[i] = Node(bin);
+        maze->changed[i] = true;
+    }
+}
+
+void Replay::load_block(ulong k)
+{
+    if (block_index == k)
+        return;
+
+    ulong o = log->keyframes[k].offset;
+    uint c = log->keyframes[k].cell;
+    ulong end = std::min(log->length, (k + 1) * log->interval);
+
+    block.clear();
+    for (ulong i = k * log->interval; i < end; ++i)
+    {
+        ulong before = o;
+        uint parent = log->decode(i, o, c);
+        block.push_back({parent, c, before});
+    }
+    block_index = k;
+}
+
+ulong Replay::position() const
+{
+    return step;
+}
+
+ulong Replay::length() const
+{
+    return log->length;
+}
+
+void Replay::seek(ulong target)
+{
+    target = std::min(target, log->length);
+
+    for (; step < target; ++step)
+    {
+        uint parent = log->decode(step, offset, cell);
+        apply(parent, cell, true);
+    }
+
+    if (step == target)
+        return;
+
+    // Carves can not be decoded backwards, so the interval containing them is decoded from its keyframe
+    ulong base = 0;
+    while (step > target)
+    {
+        ulong k = (step - 1) / log->interval;
+        load_block(k);
+        base = k * log->interval;
+        while (step > std::max(target, base))
+        {
+            --step;
+            apply(block[step - base].parent, block[step - base].child, false);
+        }
+    }
+
+    offset = block[step - base].offset;
+    cell = step == base ? log->keyframes[block_index].cell : block[step - base - 1].child;
+}
+
+#pragma endregion // Replay end
+
+} /* namespace maze */
+#pragma endregion
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "maze.hpp"
+
+#pragma region namespace maze
+namespace maze
+{
+/**
+ * @brief Compact log of all passages carved by a MazeGenerator
+ *
+ * Every carve is stored as the direction from parent to child (2 bits) and a jump flag (1 bit).
+ * The parent is the child of the previous carve unless the jump flag is set, in which case the
+ * parent's offset from that child follows as a varint. Jumps only happen after dead ends and are
+ * usually short. Every interval carves a keyframe stores the decoder state, so that decoding can
+ * start there.
+ */
+class GenerationLog
+{
+public:
+    struct Keyframe
+    {
+        ulong offset; /// Byte offset into jumps of the first carve after the keyframe
+        uint cell;    /// Child of the last carve before the keyframe
+    };
+
+    uint w;                           /// Width
+    uint h;                           /// Height
+    uint start;                       /// Cell index the generator started from
+    uint interval = 4096;             /// Carves between two keyframes
+    ulong length = 0;                 /// Number of carves
+    std::vector<uint8_t> initial;     /// Packed field before the first carve, same layout as the .mz body, empty if all zero
+    std::vector<uint8_t> directions;  /// 2 bits per carve: north, east, south, west
+    std::vector<uint8_t> flags;       /// 1 bit per carve, set if the parent is not the previous child
+    std::vector<uint8_t> jumps;       /// Parent offsets of flagged carves as varints
+    std::vector<Keyframe> keyframes;  /// Decoder state every interval carves, starting with carve 0
+
+private:
+    uint last; /// Child of the last recorded carve
+
+    /**
+     * @brief Decode the whole log once and check that every carve stays inside the maze,
+     *        connects neighbors and matches the keyframes
+     *
+     * @return true if the log is safe to replay
+     */
+    bool verify() const;
+
+public:
+    /**
+     * @brief Construct an empty Generation Log object, to be filled by load()
+     */
+    GenerationLog();
+
+    /**
+     * @brief Construct a new Generation Log object for a maze that is about to be generated
+     *
+     * @param    maze                Maze in its state before generation, field has to be loaded
+     * @param    _start              Cell index the generator starts from
+     */
+    GenerationLog(Maze *maze, uint _start);
+
+    /**
+     * @brief Append a carve to the log
+     *
+     * @param    parent              Cell index of the visited Node
+     * @param    child               Cell index of the newly visited neighbor
+     */
+    void record(uint parent, uint child);
+
+    /**
+     * @brief Decode a single carve
+     *
+     * @param    i                   Index of the carve
+     * @param    offset              Byte offset into jumps, advanced past the carve
+     * @param    cell                Child of carve i - 1, replaced by the child of carve i
+     * @return uint                  Parent of carve i
+     */
+    uint decode(ulong i, ulong &offset, uint &cell) const;
+
+    /**
+     * @brief Write the log to a file
+     *
+     * @param    path                Path to the file to write to
+     */
+    void save(std::string path) const;
+
+    /**
+     * @brief Read the log from a file
+     *
+     * @param    path                Path to the file to read from
+     * @return true if the file was a valid log
+     */
+    bool load(std::string path);
+};
+
+/**
+ * @brief Plays a GenerationLog into a Maze in both directions, without a MazeGenerator
+ */
+class Replay
+{
+private:
+    struct Carve
+    {
+        uint parent;  /// Cell index of the parent
+        uint child;   /// Cell index of the child
+        ulong offset; /// Byte offset into jumps before decoding this carve
+    };
+
+    Maze *maze;                /// Pointer to maze::Maze object that is played into
+    const GenerationLog *log;  /// Log that is played
+    ulong step = 0;            /// Number of carves currently applied
+    ulong offset = 0;          /// Byte offset into jumps of carve step
+    uint cell;                 /// Child of carve step - 1
+    std::vector<Carve> block;  /// Decoded carves of one keyframe interval, for stepping backwards
+    ulong block_index = -1ul;  /// Keyframe index of block
+
+    /**
+     * @brief Connection bitfield of Node i before the first carve
+     */
+    uint8_t initial(uint i) const;
+
+    /**
+     * @brief Set or reset the passage between parent and child
+     */
+    void apply(uint parent, uint child, bool carve);
+
+    /**
+     * @brief Decode all carves of the interval starting at keyframe k into block
+     */
+    void load_block(ulong k);
+
+public:
+    /**
+     * @brief Construct a new Replay object, initializes the field of maze to the logs initial state
+     *
+     * @param    _maze               Pointer to maze::Maze object, has to be of the same size as the log
+     * @param    _log                Pointer to the log to play
+     */
+    Replay(Maze *_maze, const GenerationLog *_log);
+
+    /**
+     * @return ulong                 Number of carves currently applied
+     */
+    ulong position() const;
+
+    /**
+     * @return ulong                 Number of carves in the log
+     */
+    ulong length() const;
+
+    /**
+     * @brief Move to a step, costs the distance to the target plus at most one keyframe interval
+     *
+     * @param    target              Number of carves that should be applied, clamped to length()
+     */
+    void seek(ulong target);
+};
+} // namespace maze
+#pragma endregion
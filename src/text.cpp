@@ -0,0 +1,137 @@
+/**
+ * @file text.cpp
+ * @author Maxi Barmetler (https://github.com/MixusMinimax)
+ * @brief Renders Mazes as text.
+ * @version 0.1
+ * @date 2020-04-11
+ */
+
+#include <string.h>
+#include <algorithm>
+
+#include "text.hpp"
+
+#pragma region namespace maze
+namespace maze
+{
+/// Corners indexed by the walls leaving them: up, right, down, left (msb to lsb)
+static const char *box_corners[16] = {
+    " ", "╴", "╷", "┐", "╶", "─", "┌", "┬",
+    "╵", "┘", "│", "┤", "└", "┴", "├", "┼"};
+
+TextRenderer::TextRenderer(Maze *_maze, bool _unicode, size_t capacity)
+{
+    maze = _maze;
+    unicode = _unicode;
+    // Box drawing characters are three bytes long in UTF-8
+    line = (unicode ? 9 : 3) * (size_t)maze->w + 4;
+    buffer.resize(std::max(capacity, 2 * line));
+}
+
+bool TextRenderer::hwall(uint x, uint y)
+{
+    if (y == maze->h)
+        return !maze->field[(y - 1) * maze->w + x].south();
+    return !maze->field[y * maze->w + x].north();
+}
+
+bool TextRenderer::vwall(uint x, uint y)
+{
+    if (x == maze->w)
+        return !maze->field[y * maze->w + x - 1].east();
+    return !maze->field[y * maze->w + x].west();
+}
+
+void TextRenderer::flush()
+{
+    os->write(buffer.data(), used);
+    used = 0;
+}
+
+void TextRenderer::border(uint y)
+{
+    uint w = maze->w;
+    uint h = maze->h;
+    char *out = buffer.data() + used;
+
+    for (uint x = 0; x <= w; ++x)
+    {
+        bool right = x < w && hwall(x, y);
+
+        if (unicode)
+        {
+            bool up = y > 0 && vwall(x, y - 1);
+            bool down = y < h && vwall(x, y);
+            bool left = x > 0 && hwall(x - 1, y);
+            const char *corner = box_corners[up << 3 | right << 2 | down << 1 | left];
+            size_t n = strlen(corner);
+            memcpy(out, corner, n);
+            out += n;
+            if (x < w)
+            {
+                memcpy(out, right ? "──" : "  ", right ? 6 : 2);
+                out += right ? 6 : 2;
+            }
+        }
+        else
+        {
+            *out++ = '+';
+            if (x < w)
+            {
+                memcpy(out, right ? "--" : "  ", 2);
+                out += 2;
+            }
+        }
+    }
+    *out++ = '\n';
+    used = out - buffer.data();
+}
+
+void TextRenderer::cells(uint y)
+{
+    uint w = maze->w;
+    char *out = buffer.data() + used;
+
+    for (uint x = 0; x <= w; ++x)
+    {
+        if (!vwall(x, y))
+            *out++ = ' ';
+        else if (unicode)
+        {
+            memcpy(out, "│", 3);
+            out += 3;
+        }
+        else
+            *out++ = '|';
+
+        if (x < w)
+        {
+            memcpy(out, "  ", 2);
+            out += 2;
+        }
+    }
+    *out++ = '\n';
+    used = out - buffer.data();
+}
+
+void TextRenderer::render(std::ostream &_os)
+{
+    os = &_os;
+    used = 0;
+
+    for (uint y = 0; y < maze->h; ++y)
+    {
+        if (buffer.size() - used < 2 * line)
+            flush();
+        border(y);
+        cells(y);
+    }
+    if (buffer.size() - used < line)
+        flush();
+    border(maze->h);
+    flush();
+    os->flush();
+}
+
+} /* namespace maze */
+#pragma endregion
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <ostream>
+#include <vector>
+
+#include "maze.hpp"
+
+#pragma region namespace maze
+namespace maze
+{
+/**
+ * @brief Renders a Maze as text, either ASCII (+--+) or Unicode box drawing characters (┌──┐).
+ *
+ * Neighboring cells share their walls, so a w x h maze becomes 2h+1 lines of 3w+1 characters.
+ * Lines are written into a preallocated buffer which is only handed to the stream when full.
+ */
+class TextRenderer
+{
+private:
+    Maze *maze;               /// Pointer to maze::Maze object that should be rendered
+    bool unicode;             /// Use box drawing characters instead of ASCII
+    std::vector<char> buffer; /// Output buffer
+    size_t used = 0;          /// Bytes in buffer that have not been written yet
+    size_t line;              /// Maximum length of a single line in bytes
+    std::ostream *os = NULL;  /// Stream that is currently rendered to
+
+    /**
+     * @brief Is there a wall on the horizontal grid line y, above cell x
+     */
+    bool hwall(uint x, uint y);
+
+    /**
+     * @brief Is there a wall on the vertical grid line x, in row y
+     */
+    bool vwall(uint x, uint y);
+
+    /**
+     * @brief Write buffer to the stream
+     */
+    void flush();
+
+    /**
+     * @brief Append the line of corners and horizontal walls above row y (y == h for the bottom border)
+     */
+    void border(uint y);
+
+    /**
+     * @brief Append the line of cells and vertical walls of row y
+     */
+    void cells(uint y);
+
+public:
+    /**
+     * @brief Construct a new Text Renderer object
+     *
+     * @param    _maze               Pointer to maze::Maze object, field has to be loaded
+     * @param    _unicode            Use box drawing characters instead of ASCII
+     * @param    capacity            Size of the output buffer, grown to at least two lines
+     */
+    TextRenderer(Maze *_maze, bool _unicode, size_t capacity = 1 << 20);
+
+    /**
+     * @brief Render the whole maze, row by row
+     *
+     * @param    _os                 Stream to write to
+     */
+    void render(std::ostream &_os);
+};
+} // namespace maze
+#pragma endregion
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#pragma region namespace maze
+namespace maze
+{
+/**
+ * @brief Position of a neighbor relative to a cell
+ */
+struct Offset
+{
+    int dx;
+    int dy;
+    int dz;
+};
+
+/*
+ * Topologies describe the shape of the cells and who their neighbors are. Every topology provides:
+ *   directions                 Number of possible neighbors, one bit of a Node each
+ *   dimensions                 2, or 3 if the maze has levels
+ *   bits                       Bits per Node in .mz files, 4 or 8
+ *   parity(x, y, z)            Which row of offsets applies to a cell, for cells that alternate in shape
+ *   offsets[parity][direction] Position of the neighbor in a direction
+ *   opposite[direction]        Direction that leads back
+ *   name                       Name on the command line
+ */
+
+/**
+ * @brief Square cells with four neighbors, the original .mz format
+ */
+struct Square
+{
+    enum
+    {
+        NORTH,
+        EAST,
+        SOUTH,
+        WEST
+    };
+
+    static constexpr uint directions = 4;
+    static constexpr uint dimensions = 2;
+    static constexpr uint bits = 4;
+    static constexpr Offset offsets[1][directions] = {
+        {{0, -1, 0}, {1, 0, 0}, {0, 1, 0}, {-1, 0, 0}}};
+    static constexpr uint8_t opposite[directions] = {SOUTH, WEST, NORTH, EAST};
+    static constexpr const char *name = "square";
+
+    static constexpr uint parity(uint, uint, uint) { return 0; }
+};
+
+/**
+ * @brief Pointy-top hexagons, odd rows are shifted half a cell to the right
+ */
+struct Hex
+{
+    enum
+    {
+        EAST,
+        NORTHEAST,
+        NORTHWEST,
+        WEST,
+        SOUTHWEST,
+        SOUTHEAST
+    };
+
+    static constexpr uint directions = 6;
+    static constexpr uint dimensions = 2;
+    static constexpr uint bits = 8;
+    static constexpr Offset offsets[2][directions] = {
+        {{1, 0, 0}, {0, -1, 0}, {-1, -1, 0}, {-1, 0, 0}, {-1, 1, 0}, {0, 1, 0}},
+        {{1, 0, 0}, {1, -1, 0}, {0, -1, 0}, {-1, 0, 0}, {0, 1, 0}, {1, 1, 0}}};
+    static constexpr uint8_t opposite[directions] = {WEST, SOUTHWEST, SOUTHEAST, EAST, NORTHEAST, NORTHWEST};
+    static constexpr const char *name = "hex";
+
+    static constexpr uint parity(uint, uint y, uint) { return y % 2; }
+};
+
+/**
+ * @brief Triangles pointing up and down in turn. A triangle pointing up (x + y even) shares its
+ *        base with the cell below, one pointing down with the cell above.
+ */
+struct Triangle
+{
+    enum
+    {
+        EAST,
+        WEST,
+        BASE
+    };
+
+    static constexpr uint directions = 3;
+    static constexpr uint dimensions = 2;
+    static constexpr uint bits = 4;
+    static constexpr Offset offsets[2][directions] = {
+        {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}},
+        {{1, 0, 0}, {-1, 0, 0}, {0, -1, 0}}};
+    static constexpr uint8_t opposite[directions] = {WEST, EAST, BASE};
+    static constexpr const char *name = "triangle";
+
+    static constexpr uint parity(uint x, uint y, uint) { return (x + y) % 2; }
+};
+
+/**
+ * @brief Square cells on several levels, connected by stairs up and down
+ */
+struct Cube
+{
+    enum
+    {
+        NORTH,
+        EAST,
+        SOUTH,
+        WEST,
+        UP,
+        DOWN
+    };
+
+    static constexpr uint directions = 6;
+    static constexpr uint dimensions = 3;
+    static constexpr uint bits = 8;
+    static constexpr Offset offsets[1][directions] = {
+        {{0, -1, 0}, {1, 0, 0}, {0, 1, 0}, {-1, 0, 0}, {0, 0, 1}, {0, 0, -1}}};
+    static constexpr uint8_t opposite[directions] = {SOUTH, WEST, NORTH, EAST, DOWN, UP};
+    static constexpr const char *name = "cube";
+
+    static constexpr uint parity(uint, uint, uint) { return 0; }
+};
+} // namespace maze
+#pragma endregion
@@ -0,0 +1,531 @@
+/**
+ * @file transform.cpp
+ * @author Maxi Barmetler (https://github.com/MixusMinimax)
+ * @brief Crops, flips, rotates and stitches packed .mz files.
+ * @version 0.1
+ * @date 2020-04-11
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <string.h>
+#include <fcntl.h>
+
+#include "transform.hpp"
+
+#define HEADER_SIZE 8
+#define TILE_BYTES (64ul << 20)
+#define BLOCK 128u
+
+#define NORTH 0b1000
+#define EAST 0b0100
+#define SOUTH 0b0010
+#define WEST 0b0001
+
+#pragma region namespace maze
+namespace maze
+{
+/**
+ * @brief Maps every node of a packed row at once: nib maps a single node,
+ *        byte both nodes of a byte, reversed both nodes of a byte and swaps them.
+ */
+struct NibbleTable
+{
+    uint8_t nib[16];
+    uint8_t byte[256];
+    uint8_t reversed[256];
+
+    NibbleTable(uint8_t (*f)(uint8_t))
+    {
+        for (int n = 0; n < 16; ++n)
+            nib[n] = f(n);
+        for (int b = 0; b < 256; ++b)
+        {
+            byte[b] = nib[b >> 4] << 4 | nib[b & 0xf];
+            reversed[b] = nib[b & 0xf] << 4 | nib[b >> 4];
+        }
+    }
+};
+
+static const NibbleTable flip_h_table([](uint8_t n) -> uint8_t { return (n & (NORTH | SOUTH)) | ((n & EAST) >> 2) | ((n & WEST) << 2); });
+static const NibbleTable flip_v_table([](uint8_t n) -> uint8_t { return (n & (EAST | WEST)) | ((n & NORTH) >> 2) | ((n & SOUTH) << 2); });
+static const NibbleTable rotate_cw_table([](uint8_t n) -> uint8_t { return (n >> 1) | ((n & WEST) << 3); });
+static const NibbleTable rotate_ccw_table([](uint8_t n) -> uint8_t { return ((n << 1) & 0xf) | (n >> 3); });
+static const NibbleTable rotate_180_table([](uint8_t n) -> uint8_t { return ((n << 2) | (n >> 2)) & 0xf; });
+
+static void set_bits(uint8_t *row, ulong x, uint8_t bits)
+{
+    row[x / 2] |= bits << ((x % 2) ? 0 : 4);
+}
+
+static void clear_bits(uint8_t *row, ulong x, uint8_t bits)
+{
+    row[x / 2] &= ~(bits << ((x % 2) ? 0 : 4));
+}
+
+/**
+ * @brief Drop the first node of a packed row, moving all others one nibble to the front
+ */
+static void shift_row(uint8_t *row, size_t bytes)
+{
+    for (size_t i = 0; i + 1 < bytes; ++i)
+        row[i] = (row[i] << 4) | (row[i + 1] >> 4);
+    row[bytes - 1] <<= 4;
+}
+
+/**
+ * @brief Round a row up to an odd number of cache lines, so that walking down a column
+ *        does not keep hitting the same cache sets
+ */
+static size_t padded_stride(size_t bytes)
+{
+    size_t lines = (bytes + 63) / 64;
+    return (lines | 1) * 64;
+}
+
+/**
+ * @brief Reverse the order of count nodes and map each of them
+ */
+static void reverse_row(const uint8_t *in, ulong count, uint8_t *out, const NibbleTable &table)
+{
+    size_t bytes = (count + 1) / 2;
+    for (size_t i = 0; i < bytes; ++i)
+        out[i] = table.reversed[in[bytes - 1 - i]];
+    // The empty low nibble of the last byte is now in front
+    if (count % 2)
+        shift_row(out, bytes);
+}
+
+/**
+ * @brief Map each of count nodes in place
+ */
+static void map_row(uint8_t *row, ulong count, const NibbleTable &table)
+{
+    size_t bytes = (count + 1) / 2;
+    for (size_t i = 0; i < bytes; ++i)
+        row[i] = table.byte[row[i]];
+}
+
+/***************************************
+// Packed Reader                      //
+***************************************/
+#pragma region Packed Reader
+
+PackedReader::PackedReader(size_t _window_size)
+{
+    window_size = _window_size;
+}
+
+PackedReader::~PackedReader()
+{
+    if (fd >= 0)
+        ::close(fd);
+}
+
+bool PackedReader::open(std::string path)
+{
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    ulong size = lseek(fd, 0, SEEK_END);
+    uint header[2];
+    if (size < HEADER_SIZE || pread(fd, header, HEADER_SIZE, 0) != HEADER_SIZE)
+        return false;
+    w = header[0];
+    h = header[1];
+    if (w == 0 || h == 0)
+        return false;
+
+    body = size - HEADER_SIZE;
+    window.resize(std::max(std::min(window_size, body), 1ul));
+    window_start = window_end = 0;
+    return body >= ((ulong)w * h + 1) / 2;
+}
+
+void PackedReader::set_window(size_t _window_size)
+{
+    window_size = _window_size;
+    window.resize(std::max(std::min(window_size, body), 1ul));
+    window_start = window_end = 0;
+}
+
+void PackedReader::read(ulong index, ulong count, uint8_t *out)
+{
+    if (!count)
+        return;
+
+    ulong first = index / 2;
+    bool odd = index % 2;
+    ulong bytes = (odd + count + 1) / 2;
+
+    if (first < window_start || first + bytes > window_end)
+    {
+        if (window.size() < bytes)
+            window.resize(bytes);
+        // Walking backwards, keep what comes before the requested range
+        if (first < window_start)
+            window_start = first + bytes > window.size() ? first + bytes - window.size() : 0;
+        else
+            window_start = first;
+        window_end = std::min(window_start + window.size(), body);
+
+        if (pread(fd, window.data(), window_end - window_start, HEADER_SIZE + window_start) < 0)
+            memset(window.data(), 0, window_end - window_start);
+    }
+
+    memcpy(out, window.data() + (first - window_start), bytes);
+    if (odd)
+        shift_row(out, bytes);
+    if (count % 2)
+        out[count / 2] &= 0xf0;
+}
+
+void PackedReader::read_rows(ulong index, ulong count, uint rows, uint8_t *out, size_t stride)
+{
+    if (!count)
+        return;
+
+    for (uint r = 0; r < rows; ++r, index += w, out += stride)
+    {
+        ulong first = index / 2;
+        bool odd = index % 2;
+        ulong bytes = (odd + count + 1) / 2;
+
+        if (pread(fd, out, bytes, HEADER_SIZE + first) < 0)
+            memset(out, 0, bytes);
+        if (odd)
+            shift_row(out, bytes);
+        if (count % 2)
+            out[count / 2] &= 0xf0;
+    }
+}
+
+#pragma endregion // Packed Reader end
+
+/***************************************
+// Packed Writer                      //
+***************************************/
+#pragma region Packed Writer
+
+PackedWriter::PackedWriter(size_t _buffer_size)
+{
+    buffer_size = _buffer_size;
+}
+
+bool PackedWriter::open(std::string path, uint w, uint h)
+{
+    buffer.resize(std::min(buffer_size, ((ulong)w * h + 1) / 2 + 2));
+    ofs.open(path, std::ios::binary | std::ios::trunc);
+    ofs.write((char *)&w, 4);
+    ofs.write((char *)&h, 4);
+    used = 0;
+    half = false;
+    return (bool)ofs;
+}
+
+void PackedWriter::flush()
+{
+    ofs.write((char *)buffer.data(), used);
+    if (half)
+        buffer[0] = buffer[used];
+    used = 0;
+}
+
+void PackedWriter::write(const uint8_t *in, ulong count)
+{
+    if (!count)
+        return;
+
+    size_t bytes = (count + 1) / 2;
+    if (buffer.size() - used < bytes + 2)
+        flush();
+    if (buffer.size() - used < bytes + 2)
+        buffer.resize(used + bytes + 2);
+
+    uint8_t *p = buffer.data() + used;
+    if (!half)
+    {
+        memcpy(p, in, bytes);
+        used += count / 2;
+        half = count % 2;
+    }
+    else
+    {
+        p[0] = (p[0] & 0xf0) | (in[0] >> 4);
+        for (size_t k = 1; k < (count + 2) / 2; ++k)
+            p[k] = (in[k - 1] << 4) | (k < bytes ? in[k] >> 4 : 0);
+        used += (count + 1) / 2;
+        half = !(count % 2);
+    }
+    if (half)
+        buffer[used] &= 0xf0;
+}
+
+bool PackedWriter::close()
+{
+    if (half)
+    {
+        ++used;
+        half = false;
+    }
+    flush();
+    ofs.close();
+    return (bool)ofs;
+}
+
+#pragma endregion // Packed Writer end
+
+/***************************************
+// Transforms                         //
+***************************************/
+#pragma region Transforms
+
+static bool open_input(PackedReader &reader, std::string path)
+{
+    if (reader.open(path))
+        return true;
+    std::cerr << "Invalid maze file: " << '"' << path << '"' << std::endl;
+    return false;
+}
+
+static bool open_output(PackedWriter &writer, std::string path, uint w, uint h)
+{
+    if (writer.open(path, w, h))
+        return true;
+    std::cerr << "Invalid path: " << '"' << path << '"' << std::endl;
+    return false;
+}
+
+bool crop_file(std::string input, std::string output, uint x, uint y, uint w, uint h)
+{
+    PackedReader reader;
+    PackedWriter writer;
+    if (!open_input(reader, input))
+        return false;
+    if (!w || !h || (ulong)x + w > reader.w || (ulong)y + h > reader.h)
+    {
+        std::cerr << "Crop rectangle " << w << 'x' << h << '+' << x << '+' << y
+                  << " does not fit into " << reader.w << 'x' << reader.h << std::endl;
+        return false;
+    }
+    if (!open_output(writer, output, w, h))
+        return false;
+
+    std::vector<uint8_t> row((w + 1) / 2 + 1);
+    for (uint r = 0; r < h; ++r)
+    {
+        reader.read((ulong)(y + r) * reader.w + x, w, row.data());
+
+        // Close passages that now lead out of the maze
+        if (r == 0)
+            for (size_t i = 0; i < (w + 1) / 2; ++i)
+                row[i] &= ~(NORTH << 4 | NORTH);
+        if (r == h - 1)
+            for (size_t i = 0; i < (w + 1) / 2; ++i)
+                row[i] &= ~(SOUTH << 4 | SOUTH);
+        clear_bits(row.data(), 0, WEST);
+        clear_bits(row.data(), w - 1, EAST);
+
+        writer.write(row.data(), w);
+    }
+    return writer.close();
+}
+
+bool flip_file(std::string input, std::string output, bool horizontal)
+{
+    PackedReader reader;
+    PackedWriter writer;
+    if (!open_input(reader, input) || !open_output(writer, output, reader.w, reader.h))
+        return false;
+
+    uint w = reader.w;
+    std::vector<uint8_t> row((w + 1) / 2 + 1);
+    std::vector<uint8_t> flipped((w + 1) / 2 + 1);
+    for (uint r = 0; r < reader.h; ++r)
+    {
+        if (horizontal)
+        {
+            reader.read((ulong)r * w, w, row.data());
+            reverse_row(row.data(), w, flipped.data(), flip_h_table);
+            writer.write(flipped.data(), w);
+        }
+        else
+        {
+            reader.read((ulong)(reader.h - 1 - r) * w, w, row.data());
+            map_row(row.data(), w, flip_v_table);
+            writer.write(row.data(), w);
+        }
+    }
+    return writer.close();
+}
+
+bool rotate_file(std::string input, std::string output, uint degrees)
+{
+    PackedReader reader;
+    PackedWriter writer;
+    if (degrees != 90 && degrees != 180 && degrees != 270)
+    {
+        std::cerr << "Invalid rotation: " << degrees << ", has to be 90, 180 or 270" << std::endl;
+        return false;
+    }
+    if (!open_input(reader, input))
+        return false;
+
+    uint w = reader.w;
+    uint h = reader.h;
+
+    if (degrees == 180)
+    {
+        if (!open_output(writer, output, w, h))
+            return false;
+        std::vector<uint8_t> row((w + 1) / 2 + 1);
+        std::vector<uint8_t> rotated((w + 1) / 2 + 1);
+        for (uint r = h; r-- > 0;)
+        {
+            reader.read((ulong)r * w, w, row.data());
+            reverse_row(row.data(), w, rotated.data(), rotate_180_table);
+            writer.write(rotated.data(), w);
+        }
+        return writer.close();
+    }
+
+    if (!open_output(writer, output, h, w))
+        return false;
+
+    // Columns of the input become rows of the output. A tile of the input, all rows but only
+    // some columns, is read at once and transposed into a band of output rows.
+    bool cw = degrees == 90;
+    const NibbleTable &table = cw ? rotate_cw_table : rotate_ccw_table;
+    uint columns = std::clamp<ulong>(TILE_BYTES * 2 / std::max(h, 1u), 1, w);
+    uint pairs = (h + 1) / 2;
+    size_t in_stride = padded_stride((columns + 1) / 2 + 1);
+    size_t out_stride = padded_stride(pairs + 1);
+    // Both are walked column by column, huge pages keep that from missing the TLB on every row
+    Arena arena(Arena::TRANSPARENT);
+    uint8_t *tile = (uint8_t *)arena.allocate(in_stride * h);
+    uint8_t *band = (uint8_t *)arena.allocate(out_stride * columns);
+    std::vector<uint8_t> block(BLOCK * BLOCK / 2);
+    // Stands in for the missing last input row if h is odd
+    std::vector<uint8_t> zero(in_stride, 0);
+
+    for (uint y0 = 0; y0 < w; y0 += columns)
+    {
+        uint n = std::min(columns, w - y0);
+        uint x0 = cw ? y0 : w - y0 - n;
+        reader.read_rows(x0, n, h, tile, in_stride);
+
+        // Every output byte holds two nodes from the same input column and neighboring input rows.
+        // The tile is transposed in blocks of BLOCK x BLOCK nodes: BLOCK input rows are read one
+        // cache line each, the result is collected in block and copied to the band row by row.
+        for (uint kb = 0; kb < pairs; kb += BLOCK / 2)
+        {
+            uint ke = std::min(kb + BLOCK / 2, pairs);
+            for (uint jb = 0; jb < n; jb += BLOCK)
+            {
+                uint je = std::min(jb + BLOCK, n);
+                for (uint k = kb; k < ke; ++k)
+                {
+                    // Input rows of output columns 2k and 2k + 1, the latter may not exist if h is odd
+                    const uint8_t *hi = tile + (cw ? h - 1 - 2 * k : 2 * k) * in_stride;
+                    const uint8_t *lo = 2 * k + 1 < h ? tile + (cw ? h - 2 - 2 * k : 2 * k + 1) * in_stride : zero.data();
+                    uint8_t *out = block.data() + (k - kb);
+                    // One input byte of each row holds output rows j and j + 1
+                    for (uint j = jb; j < je; j += 2, out += BLOCK)
+                    {
+                        uint8_t a = table.byte[hi[j / 2]];
+                        uint8_t b = table.byte[lo[j / 2]];
+                        out[0] = (a & 0xf0) | (b >> 4);
+                        out[BLOCK / 2] = (a << 4) | (b & 0x0f);
+                    }
+                }
+                for (uint j = jb; j < je; ++j)
+                    memcpy(band + (cw ? j : n - 1 - j) * out_stride + kb, block.data() + (j - jb) * (BLOCK / 2), ke - kb);
+            }
+        }
+
+        for (uint j = 0; j < n; ++j)
+            writer.write(band + j * out_stride, h);
+    }
+    return writer.close();
+}
+
+bool stitch_files(std::vector<std::string> inputs, uint columns, std::string output)
+{
+    if (!columns || inputs.empty() || inputs.size() % columns)
+    {
+        std::cerr << "Can not arrange " << inputs.size() << " mazes in " << columns << " columns" << std::endl;
+        return false;
+    }
+    uint rows = inputs.size() / columns;
+
+    std::vector<PackedReader> readers(inputs.size());
+    for (size_t i = 0; i < inputs.size(); ++i)
+    {
+        readers[i].set_window(std::max(TILE_BYTES / inputs.size(), 1ul << 16));
+        if (!open_input(readers[i], inputs[i]))
+            return false;
+    }
+
+    uint w = 0, h = 0;
+    for (uint c = 0; c < columns; ++c)
+        w += readers[c].w;
+    for (uint r = 0; r < rows; ++r)
+        h += readers[r * columns].h;
+    for (uint r = 0; r < rows; ++r)
+    {
+        for (uint c = 0; c < columns; ++c)
+        {
+            PackedReader &tile = readers[r * columns + c];
+            if (tile.w != readers[c].w || tile.h != readers[r * columns].h)
+            {
+                std::cerr << '"' << inputs[r * columns + c] << '"' << " is " << tile.w << 'x' << tile.h
+                          << ", expected " << readers[c].w << 'x' << readers[r * columns].h << std::endl;
+                return false;
+            }
+        }
+    }
+
+    PackedWriter writer;
+    if (!open_output(writer, output, w, h))
+        return false;
+
+    // Every maze is connected to its left neighbor in its middle row, and mazes in the first
+    // column to the one above in their middle column. That is a spanning tree over the grid.
+    std::vector<uint8_t> row;
+    for (uint r = 0; r < rows; ++r)
+    {
+        uint th = readers[r * columns].h;
+        for (uint y = 0; y < th; ++y)
+        {
+            for (uint c = 0; c < columns; ++c)
+            {
+                uint tw = readers[c].w;
+                row.resize((tw + 1) / 2 + 1);
+                readers[r * columns + c].read((ulong)y * tw, tw, row.data());
+
+                if (y == th / 2 && c > 0)
+                    set_bits(row.data(), 0, WEST);
+                if (y == th / 2 && c + 1 < columns)
+                    set_bits(row.data(), tw - 1, EAST);
+                if (c == 0 && y == 0 && r > 0)
+                    set_bits(row.data(), tw / 2, NORTH);
+                if (c == 0 && y == th - 1 && r + 1 < rows)
+                    set_bits(row.data(), tw / 2, SOUTH);
+
+                writer.write(row.data(), tw);
+            }
+        }
+    }
+    return writer.close();
+}
+
+#pragma endregion // Transforms end
+
+#undef NORTH
+#undef EAST
+#undef SOUTH
+#undef WEST
+
+} /* namespace maze */
+#pragma endregion
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "maze.hpp"
+
+#pragma region namespace maze
+namespace maze
+{
+/**
+ * @brief Reads ranges of nodes from a .mz file without unpacking them.
+ *
+ * Nodes are returned packed, two per byte, with the first node in the high nibble of the first byte,
+ * no matter where the range starts in the file. Reads are served from a window that is refilled
+ * in the direction the file is being walked.
+ */
+class PackedReader
+{
+private:
+    int fd = -1;                 /// File descriptor, read with pread so that no seeks are needed
+    std::vector<uint8_t> window; /// Cached bytes of the body, starting at window_start
+    size_t window_size;          /// Bytes read from the file at once, unless the body is smaller
+    ulong window_start = 0;      /// Body offset of window[0]
+    ulong window_end = 0;        /// Body offset one past the last cached byte
+    ulong body = 0;              /// Size of the body in bytes
+
+public:
+    uint w = 0; /// Width
+    uint h = 0; /// Height
+
+    /**
+     * @brief Construct a new Packed Reader object
+     *
+     * @param    window_size         Bytes read from the file at once
+     */
+    PackedReader(size_t window_size = 64 << 20);
+
+    PackedReader(const PackedReader &) = delete;
+    PackedReader &operator=(const PackedReader &) = delete;
+
+    ~PackedReader();
+
+    /**
+     * @brief Open a .mz file and read its header
+     *
+     * @return true if the file exists, describes a non-empty maze and is large enough for it
+     */
+    bool open(std::string path);
+
+    /**
+     * @brief Change the number of bytes read from the file at once
+     */
+    void set_window(size_t window_size);
+
+    /**
+     * @brief Read a range of nodes
+     *
+     * @param    index               Index of the first node, y * w + x
+     * @param    count               Number of nodes
+     * @param    out                 Receives (count + 1) / 2 bytes, needs room for one more
+     */
+    void read(ulong index, ulong count, uint8_t *out);
+
+    /**
+     * @brief Read the same range of nodes from consecutive rows, without going through the window.
+     *        Every row is read directly into out with one positioned read, in file order.
+     *
+     * @param    index               Index of the first node in the first row, y * w + x
+     * @param    count               Number of nodes per row
+     * @param    rows                Number of rows
+     * @param    out                 Receives rows of (count + 1) / 2 bytes
+     * @param    stride              Distance between two rows in out, at least (count + 1) / 2 + 1
+     */
+    void read_rows(ulong index, ulong count, uint rows, uint8_t *out, size_t stride);
+};
+
+/**
+ * @brief Writes a .mz file from packed rows, buffered.
+ */
+class PackedWriter
+{
+private:
+    std::ofstream ofs;
+    std::vector<uint8_t> buffer; /// Bytes that have not been written yet
+    size_t buffer_size;          /// Bytes written to the file at once, unless the body is smaller
+    size_t used = 0;             /// Complete bytes in buffer
+    bool half = false;           /// buffer[used] holds a node in its high nibble
+
+    /**
+     * @brief Write all complete bytes to the file
+     */
+    void flush();
+
+public:
+    /**
+     * @brief Construct a new Packed Writer object
+     *
+     * @param    buffer_size         Bytes written to the file at once
+     */
+    PackedWriter(size_t buffer_size = 64 << 20);
+
+    /**
+     * @brief Create a .mz file and write its header
+     */
+    bool open(std::string path, uint w, uint h);
+
+    /**
+     * @brief Append nodes
+     *
+     * @param    in                  Packed nodes, the first one in the high nibble of in[0]
+     * @param    count               Number of nodes
+     */
+    void write(const uint8_t *in, ulong count);
+
+    /**
+     * @brief Write the remaining nodes and close the file
+     *
+     * @return true if everything was written
+     */
+    bool close();
+};
+
+/**
+ * @brief Cut a rectangle out of a maze. Passages that would leave the rectangle are closed.
+ *
+ * @return true on success, errors are printed to stderr
+ */
+bool crop_file(std::string input, std::string output, uint x, uint y, uint w, uint h);
+
+/**
+ * @brief Mirror a maze
+ *
+ * @param    horizontal          Swap left and right, otherwise top and bottom
+ * @return true on success, errors are printed to stderr
+ */
+bool flip_file(std::string input, std::string output, bool horizontal);
+
+/**
+ * @brief Rotate a maze clockwise
+ *
+ * @param    degrees             90, 180 or 270
+ * @return true on success, errors are printed to stderr
+ */
+bool rotate_file(std::string input, std::string output, uint degrees);
+
+/**
+ * @brief Place mazes next to each other in a grid and connect each one to the grid by one passage,
+ *        so that the result is a single maze again. All mazes in a row of the grid need the same
+ *        height, all mazes in a column the same width.
+ *
+ * @param    inputs              Paths of the mazes, row by row
+ * @param    columns             Number of mazes per row
+ * @return true on success, errors are printed to stderr
+ */
+bool stitch_files(std::vector<std::string> inputs, uint columns, std::string output);
+} // namespace maze
+#pragma endregion